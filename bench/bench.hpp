@@ -0,0 +1,110 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
+//=============================================================================
+// 微基准测试框架
+//=============================================================================
+
+// 全局 operator new 计数（在 bench_main.cpp 中替换）
+extern std::atomic<size_t> benchAllocCount;
+extern std::atomic<size_t> benchAllocBytes;
+
+// 单项测试结果，最终输出为 JSON
+struct BenchResult
+{
+	std::string name;
+	size_t iterations{};
+	double nsPerOp{};
+	double allocsPerOp{};
+	double bytesPerOp{};
+	std::vector<std::pair<std::string, double>> counters; // 额外指标，如 cmds_per_sec
+};
+
+struct BenchContext
+{
+	std::string filter;     // 只运行名字包含 filter 的测试
+	double minTimeMs{ 200 }; // 每项测试至少运行的时间
+	std::vector<BenchResult> results;
+
+	bool enabled(const std::string& name) const
+	{
+		return filter.empty() || name.find(filter) != std::string::npos;
+	}
+
+	// 反复执行 op 直到累计时间超过 minTimeMs，返回结果（未启用时返回 nullptr）
+	template <typename F>
+	BenchResult* run(const std::string& name, F&& op)
+	{
+		if (!enabled(name)) return nullptr;
+
+		op(); // 预热
+
+		using Clock = std::chrono::steady_clock;
+		size_t batch = 1;
+		size_t iterations = 0;
+		double elapsedNs = 0;
+		size_t allocs = 0;
+		size_t bytes = 0;
+		while (elapsedNs < minTimeMs * 1e6)
+		{
+			size_t allocsBefore = benchAllocCount.load();
+			size_t bytesBefore = benchAllocBytes.load();
+			auto start = Clock::now();
+			for (size_t i = 0; i < batch; ++i)
+			{
+				op();
+			}
+			elapsedNs += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+			allocs += benchAllocCount.load() - allocsBefore;
+			bytes += benchAllocBytes.load() - bytesBefore;
+			iterations += batch;
+			batch *= 2;
+		}
+
+		BenchResult result;
+		result.name = name;
+		result.iterations = iterations;
+		result.nsPerOp = elapsedNs / iterations;
+		result.allocsPerOp = static_cast<double>(allocs) / iterations;
+		result.bytesPerOp = static_cast<double>(bytes) / iterations;
+		results.push_back(std::move(result));
+		return &results.back();
+	}
+};
+
+// 临时目录，析构时递归删除
+struct TempDir
+{
+	std::string path;
+
+	TempDir();
+	~TempDir();
+	TempDir(const TempDir&) = delete;
+	TempDir& operator=(const TempDir&) = delete;
+};
+
+// 临时替换 shell 变量（导出到环境），析构时恢复
+struct ScopedEnv
+{
+	std::string name;
+	std::string oldValue;
+	bool hadValue{};
+
+	ScopedEnv(const std::string& envName, const std::string& value);
+	~ScopedEnv();
+};
+
+// 各模块的测试
+void runParserBenchmarks(BenchContext& ctx);
+void runLookupBenchmarks(BenchContext& ctx);
+void runHistoryBenchmarks(BenchContext& ctx);
+void runSpawnBenchmarks(BenchContext& ctx);
+void runSubstitutionBenchmarks(BenchContext& ctx);
+void runGlobBenchmarks(BenchContext& ctx);
+void runRedirectBenchmarks(BenchContext& ctx);
+void runPipeBenchmarks(BenchContext& ctx);
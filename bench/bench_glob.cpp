@@ -0,0 +1,111 @@
+#include "bench.hpp"
+#include "glob.hpp"
+#include "options.hpp"
+
+#include <fcntl.h>
+#include <glob.h>        // glob(3)，作为对照
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//=============================================================================
+// 路径名展开
+//=============================================================================
+
+const size_t FLAT_FILES = 100000;
+const size_t TREE_FANOUT = 8;      // 三层，共 8 + 64 + 512 个目录
+const size_t FILES_PER_TREE_DIR = 20;
+
+void createEmptyFile(const std::string& path)
+{
+	int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+	if (fd != -1) close(fd);
+}
+
+// 在 dir 下创建 FLAT_FILES 个文件，一半是 .log
+void makeFlatDir(const std::string& dir)
+{
+	mkdir(dir.c_str(), 0755);
+	for (size_t i = 0; i < FLAT_FILES; ++i)
+	{
+		createEmptyFile(dir + "/file" + std::to_string(i) + (i % 2 == 0 ? ".log" : ".txt"));
+	}
+}
+
+// 在 dir 下创建 depth 层、每层 TREE_FANOUT 个子目录的目录树，每个目录 FILES_PER_TREE_DIR 个 .txt 文件
+void makeTree(const std::string& dir, size_t depth)
+{
+	mkdir(dir.c_str(), 0755);
+	for (size_t f = 0; f < FILES_PER_TREE_DIR; ++f)
+	{
+		createEmptyFile(dir + "/f" + std::to_string(f) + ".txt");
+	}
+	if (depth == 0) return;
+	for (size_t d = 0; d < TREE_FANOUT; ++d)
+	{
+		makeTree(dir + "/d" + std::to_string(d), depth - 1);
+	}
+}
+
+void runGlobBenchmarks(BenchContext& ctx)
+{
+	// 创建十万个文件需要几秒，没有选中任何 glob 测试时跳过
+	if (!ctx.enabled("glob/")) return;
+
+	TempDir root;
+	std::string flat = root.path + "/flat";
+	std::string tree = root.path + "/tree";
+	makeFlatDir(flat);
+	makeTree(tree, 3);
+
+	std::vector<std::string> matches;
+	auto expectMatches = [&](const std::string& pattern, size_t expected) {
+		matches.clear();
+		expandGlob(pattern, matches);
+		if (matches.size() != expected) std::abort();
+	};
+
+	GlobMatcher matcher;
+	compileGlob("file1*[0-9].l?g", matcher);
+	auto listing = readDirectoryListing(flat + "/");
+	if (BenchResult* r = ctx.run("glob/match_100k_names", [&]() {
+		size_t count = 0;
+		for (size_t i = 0; i < listing->size(); ++i)
+		{
+			count += globMatch(matcher, listing->name(i));
+		}
+		if (count == 0) std::abort();
+	}))
+	{
+		r->counters.push_back({ "names_per_sec", 1e9 * FLAT_FILES / r->nsPerOp });
+	}
+
+	ctx.run("glob/star_suffix_100k_uncached", [&]() {
+		clearGlobCache();
+		expectMatches(flat + "/*.log", FLAT_FILES / 2);
+	});
+
+	clearGlobCache();
+	ctx.run("glob/star_suffix_100k_cached", [&]() {
+		expectMatches(flat + "/*.log", FLAT_FILES / 2);
+	});
+
+	ctx.run("glob/libc_glob_100k", [&]() {
+		glob_t result;
+		if (glob((flat + "/*.log").c_str(), 0, nullptr, &result) != 0 || result.gl_pathc != FLAT_FILES / 2) std::abort();
+		globfree(&result);
+	});
+
+	// ** 遍历 584 个目录
+	size_t treeDirs = TREE_FANOUT + TREE_FANOUT * TREE_FANOUT + TREE_FANOUT * TREE_FANOUT * TREE_FANOUT + 1;
+	optGlobstar = true;
+	if (BenchResult* r = ctx.run("glob/globstar_584_dirs_uncached", [&]() {
+		clearGlobCache();
+		expectMatches(tree + "/**/*.txt", treeDirs * FILES_PER_TREE_DIR);
+	}))
+	{
+		r->counters.push_back({ "dirs", static_cast<double>(treeDirs) });
+	}
+	optGlobstar = false;
+	clearGlobCache();
+}
@@ -0,0 +1,119 @@
+#include "bench.hpp"
+#include "history.hpp"
+#include "history_search.hpp"
+
+#include <fstream>
+#include <string>
+
+//=============================================================================
+// 历史记录
+//=============================================================================
+
+const size_t HISTORY_LINES = 200000;
+
+void runHistoryBenchmarks(BenchContext& ctx)
+{
+	TempDir root;
+	std::string histFile = root.path + "/histfile";
+	{
+		std::ofstream out(histFile);
+		for (size_t i = 0; i < HISTORY_LINES; ++i)
+		{
+			out << "git commit -m \"change number " << i << "\"\n";
+		}
+	}
+
+	// 启动：读入文件并调出最近一条（上箭头），只为最后一行建立索引
+	if (BenchResult* r = ctx.run("history/load_200k_lines", [&]() {
+		commandHistory.clear();
+		loadHistoryFromFile(histFile);
+		std::string entry;
+		if (!commandHistory.recent(0, entry)) std::abort();
+	}))
+	{
+		r->counters.push_back({ "lines", static_cast<double>(HISTORY_LINES) });
+	}
+
+	// history 列表：为整个文件建立行索引
+	ctx.run("history/index_200k_lines", [&]() {
+		commandHistory.clear();
+		loadHistoryFromFile(histFile);
+		if (commandHistory.size() != HISTORY_LINES) std::abort();
+	});
+
+	// Ctrl-R：首次搜索建立 trigram 索引，之后每次按键只查索引
+	commandHistory.clear();
+	loadHistoryFromFile(histFile);
+	ctx.run("history/search_index_build", [&]() {
+		historySearchIndex = HistorySearchIndex();
+		updateHistorySearchIndex();
+	});
+
+	if (BenchResult* r = ctx.run("history/search_query", [&]() {
+		size_t found;
+		if (!searchHistoryBackward("number 1234", commandHistory.size(), found)) std::abort();
+	}))
+	{
+		r->counters.push_back({ "lines", static_cast<double>(HISTORY_LINES) });
+	}
+
+	// erasedups：删除会话中的重复条目只重建会话部分的索引，HISTFILE 的 20 万行不重建
+	for (size_t i = 0; i < 1000; ++i)
+	{
+		commandHistory.push_back("make target" + std::to_string(i % 100));
+	}
+	updateHistorySearchIndex();
+	size_t repeat = 0;
+	if (BenchResult* r = ctx.run("history/search_after_session_erase", [&]() {
+		std::string command = "make target" + std::to_string(repeat++ % 100);
+		commandHistory.eraseSession(command, 0);
+		commandHistory.push_back(command);
+		size_t found;
+		if (!searchHistoryBackward("number 1234", commandHistory.size(), found)) std::abort();
+	}))
+	{
+		r->counters.push_back({ "file_lines", static_cast<double>(HISTORY_LINES) });
+		r->counters.push_back({ "session_lines", static_cast<double>(commandHistory.sessionCount()) });
+	}
+
+	// 会话记录：10 万条命令只有 50 种，对比每条一个 std::string 的内存
+	const size_t SESSION_ENTRIES = 100000;
+	std::vector<std::string> commands;
+	for (size_t i = 0; i < 50; ++i)
+	{
+		commands.push_back("git log --oneline --graph -n " + std::to_string(i));
+	}
+	size_t sessionBytes = 0;
+	if (BenchResult* r = ctx.run("history/session_push_100k_dup_heavy", [&]() {
+		commandHistory.clear();
+		for (size_t i = 0; i < SESSION_ENTRIES; ++i)
+		{
+			commandHistory.push_back(commands[i % commands.size()]);
+		}
+		sessionBytes = commandHistory.textArena.capacity() + commandHistory.texts.capacity() * sizeof(HistoryStore::TextSpan) +
+			commandHistory.textSlots.capacity() * sizeof(uint32_t) + commandHistory.sessionLines.capacity() * sizeof(uint32_t);
+	}))
+	{
+		double stringBytes = sizeof(std::string) + commands[0].length() + 1;
+		r->counters.push_back({ "bytes_per_entry", static_cast<double>(sessionBytes) / SESSION_ENTRIES });
+		r->counters.push_back({ "string_bytes_per_entry", stringBytes });
+	}
+
+	std::string outFile = root.path + "/histout";
+	commandHistory.clear();
+	loadHistoryFromFile(histFile);
+	ctx.run("history/save_200k_lines", [&]() {
+		saveHistoryToFile(outFile);
+	});
+
+	// 退出：只追加本次会话的新命令
+	std::string appendFile = root.path + "/histappend";
+	commandHistory.push_back("make -j8 && ./build/shell");
+	size_t sessionStart = commandHistory.sessionCount() - 1;
+	ctx.run("history/append_entry", [&]() {
+		appendHistoryToFile(appendFile, sessionStart);
+	});
+
+	commandHistory.clear();
+	historySearchIndex = HistorySearchIndex();
+}
@@ -0,0 +1,91 @@
+#include "bench.hpp"
+#include "command_lookup.hpp"
+#include "completion.hpp"
+
+#include <fcntl.h>
+#include <set>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//=============================================================================
+// PATH 查找与补全
+//=============================================================================
+
+const size_t PATH_DIRS = 20;
+const size_t FILES_PER_DIR = 300;
+
+// 在 root 下创建 PATH_DIRS 个目录，每个目录 FILES_PER_DIR 个可执行文件，返回 PATH 字符串
+std::string makeLargePath(const std::string& root)
+{
+	std::string pathEnv;
+	for (size_t d = 0; d < PATH_DIRS; ++d)
+	{
+		std::string dir = root + "/bin" + std::to_string(d);
+		mkdir(dir.c_str(), 0755);
+		for (size_t f = 0; f < FILES_PER_DIR; ++f)
+		{
+			std::string file = dir + "/cmd" + std::to_string(d) + "_" + std::to_string(f);
+			int fd = open(file.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0755);
+			if (fd != -1) close(fd);
+		}
+		if (!pathEnv.empty()) pathEnv += ':';
+		pathEnv += dir;
+	}
+	return pathEnv;
+}
+
+void runLookupBenchmarks(BenchContext& ctx)
+{
+	TempDir root;
+	std::string pathEnv = makeLargePath(root.path);
+	ScopedEnv path("PATH", pathEnv);
+
+	// 位于最后一个目录的命令：未缓存时要对每个目录调用 access()
+	std::string lastCmd = "cmd" + std::to_string(PATH_DIRS - 1) + "_0";
+
+	ctx.run("lookup/search_path_last_dir_20_dirs", [&]() {
+		if (searchPath(lastCmd).empty()) std::abort();
+	});
+
+	clearCommandHash();
+	ctx.run("lookup/find_executable_hashed", [&]() {
+		if (findExecutable(lastCmd).empty()) std::abort();
+	});
+
+	ctx.run("lookup/find_executable_not_found", [&]() {
+		if (!findExecutable("no_such_command").empty()) std::abort();
+	});
+
+	if (BenchResult* r = ctx.run("completion/build_index_6000_executables", [&]() {
+		CompletionIndex index = buildCompletionIndex(pathEnv);
+		if (index.names.size() != PATH_DIRS * FILES_PER_DIR) std::abort();
+	}))
+	{
+		r->counters.push_back({ "executables", static_cast<double>(PATH_DIRS * FILES_PER_DIR) });
+	}
+
+	refreshCompletionIndex();
+	ctx.run("completion/refresh_unchanged", [&]() {
+		refreshCompletionIndex();
+	});
+
+	ctx.run("completion/match_prefix_300", [&]() {
+		std::set<std::string> matches = completeCommandName("cmd7_");
+		if (matches.size() != FILES_PER_DIR) std::abort();
+	});
+
+	ctx.run("completion/match_prefix_unique", [&]() {
+		std::set<std::string> matches = completeCommandName("cmd7_299");
+		if (matches.size() != 1) std::abort();
+	});
+
+	std::set<std::string> candidates;
+	for (size_t i = 0; i < 1000; ++i)
+	{
+		candidates.insert("some-common-prefix-" + std::to_string(i));
+	}
+	ctx.run("completion/longest_common_prefix_1000", [&]() {
+		if (longestCommonPrefix(candidates).empty()) std::abort();
+	});
+}
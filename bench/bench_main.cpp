@@ -0,0 +1,134 @@
+#include "bench.hpp"
+#include "variables.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <new>
+#include <unistd.h>
+
+//=============================================================================
+// 分配计数：替换全局 operator new，统计 shell_core 中的所有堆分配
+//=============================================================================
+
+std::atomic<size_t> benchAllocCount{ 0 };
+std::atomic<size_t> benchAllocBytes{ 0 };
+
+void* operator new(size_t size)
+{
+	benchAllocCount.fetch_add(1, std::memory_order_relaxed);
+	benchAllocBytes.fetch_add(size, std::memory_order_relaxed);
+	void* p = std::malloc(size ? size : 1);
+	if (p == nullptr) throw std::bad_alloc();
+	return p;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+
+//=============================================================================
+// 辅助类型
+//=============================================================================
+
+TempDir::TempDir()
+{
+	char tmpl[] = "/tmp/shell_bench.XXXXXX";
+	char* dir = mkdtemp(tmpl);
+	if (dir == nullptr)
+	{
+		std::perror("mkdtemp");
+		std::exit(1);
+	}
+	path = dir;
+}
+
+TempDir::~TempDir()
+{
+	std::error_code ec;
+	std::filesystem::remove_all(path, ec);
+}
+
+ScopedEnv::ScopedEnv(const std::string& envName, const std::string& value) : name(envName)
+{
+	const std::string* old = getVariable(name);
+	hadValue = old != nullptr;
+	if (hadValue) oldValue = *old;
+	setVariable(name, value);
+	exportVariable(name, true);
+}
+
+ScopedEnv::~ScopedEnv()
+{
+	if (hadValue)
+		setVariable(name, oldValue);
+	else
+		unsetVariable(name);
+}
+
+//=============================================================================
+// JSON 输出
+//=============================================================================
+
+void printJson(const std::vector<BenchResult>& results)
+{
+	std::printf("{\n  \"benchmarks\": [\n");
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		const BenchResult& r = results[i];
+		std::printf("    {\"name\": \"%s\", \"iterations\": %zu, \"ns_per_op\": %.1f, \"allocs_per_op\": %.2f, \"bytes_per_op\": %.1f",
+			r.name.c_str(), r.iterations, r.nsPerOp, r.allocsPerOp, r.bytesPerOp);
+		for (const auto& [key, value] : r.counters)
+		{
+			std::printf(", \"%s\": %.2f", key.c_str(), value);
+		}
+		std::printf("}%s\n", i + 1 < results.size() ? "," : "");
+	}
+	std::printf("  ]\n}\n");
+}
+
+//=============================================================================
+// 主函数
+//=============================================================================
+
+int main(int argc, char* argv[])
+{
+	initShellVariables();
+	BenchContext ctx;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+		{
+			ctx.filter = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--min-time") == 0 && i + 1 < argc)
+		{
+			ctx.minTimeMs = std::atof(argv[++i]);
+		}
+		else
+		{
+			std::cerr << "usage: " << argv[0] << " [--filter name] [--min-time ms]" << std::endl;
+			return 2;
+		}
+	}
+
+	runParserBenchmarks(ctx);
+	runLookupBenchmarks(ctx);
+	runHistoryBenchmarks(ctx);
+	runSpawnBenchmarks(ctx);
+	runSubstitutionBenchmarks(ctx);
+	runGlobBenchmarks(ctx);
+	runRedirectBenchmarks(ctx);
+	runPipeBenchmarks(ctx);
+
+	printJson(ctx.results);
+	return 0;
+}
@@ -0,0 +1,78 @@
+#include "bench.hpp"
+#include "parser.hpp"
+
+#include <string>
+
+//=============================================================================
+// 命令解析
+//=============================================================================
+
+// 带大量引号、转义和重定向的长命令行
+std::string makeLongQuotedLine(size_t words)
+{
+	std::string line = "echo";
+	for (size_t i = 0; i < words; ++i)
+	{
+		switch (i % 4)
+		{
+		case 0: line += " 'single quoted " + std::to_string(i) + "'"; break;
+		case 1: line += " \"double \\\"quoted\\\" " + std::to_string(i) + "\""; break;
+		case 2: line += " escaped\\ word" + std::to_string(i); break;
+		default: line += " plain" + std::to_string(i); break;
+		}
+	}
+	return line + " > out.txt 2>> err.txt";
+}
+
+// cmd0 | cmd1 | ... 共 stages 级管道
+std::string makeDeepPipeline(size_t stages)
+{
+	std::string line = "cat input.log";
+	for (size_t i = 1; i < stages; ++i)
+	{
+		line += " | grep -v 'pattern " + std::to_string(i) + "'";
+	}
+	return line;
+}
+
+void runParserBenchmarks(BenchContext& ctx)
+{
+	ParsedLine parsed;
+
+	auto parseBench = [&](const std::string& name, const std::string& line) {
+		ctx.run(name, [&]() {
+			parseLine(line, parsed);
+			for (const auto& pipeline : parsed.lists[0].pipelines)
+			{
+				for (const auto& cmd : pipeline.commands)
+				{
+					std::vector<char*> argv = buildArgv(cmd);
+					if (argv.empty()) std::abort();
+				}
+			}
+		});
+	};
+
+	parseBench("parser/simple", "ls -la /tmp");
+	parseBench("parser/long_quoted_256_words", makeLongQuotedLine(256));
+	parseBench("parser/deep_pipeline_64_stages", makeDeepPipeline(64));
+
+	// 每次使用新的 ParsedLine：包含 arena 和命令数组的首次分配
+	std::string simple = "git commit -m \"a fairly long commit message\" --author=\"Someone <x@y>\"";
+	ctx.run("parser/fresh_parsed_line", [&]() {
+		ParsedLine fresh;
+		parseLine(simple, fresh);
+		std::vector<char*> argv = buildArgv(fresh.lists[0].pipelines[0].commands[0]);
+		if (argv.empty()) std::abort();
+	});
+
+	std::string escapes;
+	for (int i = 0; i < 512; ++i)
+	{
+		escapes += "text\\n\\t\\101\\\\more ";
+	}
+	ctx.run("parser/decode_echo_escapes_10k", [&]() {
+		std::string decoded = decodeEchoEscapes(escapes);
+		if (decoded.empty()) std::abort();
+	});
+}
@@ -0,0 +1,59 @@
+#include "bench.hpp"
+#include "executor.hpp"
+
+#include <cstdlib>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+
+//=============================================================================
+// 管道缓冲区大小
+//=============================================================================
+
+// 子进程以 stdio 缓冲区大小的块写入 total 字节，父进程读完：
+// 缓冲区越小，写端和读端轮流阻塞、切换的次数越多
+void streamThroughPipe(int pipeSize, size_t total)
+{
+	int fds[2];
+	if (!createPipe(fds, pipeSize)) std::abort();
+
+	pid_t pid = fork();
+	if (pid == 0)
+	{
+		close(fds[0]);
+		static char chunk[4096];
+		for (size_t written = 0; written < total;)
+		{
+			ssize_t n = write(fds[1], chunk, sizeof(chunk));
+			if (n <= 0) _exit(1);
+			written += n;
+		}
+		_exit(0);
+	}
+	close(fds[1]);
+
+	static char buf[128 * 1024];
+	size_t received = 0;
+	ssize_t n;
+	while ((n = read(fds[0], buf, sizeof(buf))) > 0) received += n;
+	close(fds[0]);
+	waitpid(pid, nullptr, 0);
+	if (received != total) std::abort();
+}
+
+void runPipeBenchmarks(BenchContext& ctx)
+{
+	const size_t total = 64u << 20;
+	const std::pair<const char*, int> sizes[] = {
+		{ "64k", 0 }, // 内核默认
+		{ "256k", 256 * 1024 },
+		{ "1m", 1024 * 1024 },
+	};
+	for (const auto& [label, size] : sizes)
+	{
+		if (BenchResult* r = ctx.run(std::string("pipe/stream_64mb_buffer_") + label, [&]() { streamThroughPipe(size, total); }))
+		{
+			r->counters.push_back({ "mb_per_sec", 64 * 1e3 / r->nsPerOp * 1e6 });
+		}
+	}
+}
@@ -0,0 +1,54 @@
+#include "bench.hpp"
+#include "executor.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+
+//=============================================================================
+// 重定向：here-document / here-string
+//=============================================================================
+
+void runRedirectBenchmarks(BenchContext& ctx)
+{
+	// 读回全部内容，确认命令能完整读到
+	auto drain = [](int fd, size_t expected) {
+		static char buf[64 * 1024];
+		size_t total = 0;
+		ssize_t n;
+		while ((n = read(fd, buf, sizeof(buf))) > 0) total += n;
+		close(fd);
+		if (total != expected) std::abort();
+	};
+
+	// 小的正文：一次写入管道
+	std::string small(200, 'x');
+	ctx.run("redirect/here_input_200b_pipe", [&]() {
+		int fd = openHereInput(small, true);
+		drain(fd, small.size() + 1);
+	});
+
+	// 大的正文：写入 memfd，与写临时文件（写入、unlink、回到开头）对比
+	std::string large(4 * 1024 * 1024, 'y');
+	if (BenchResult* r = ctx.run("redirect/here_input_4mb_memfd", [&]() {
+			int fd = openHereInput(large, false);
+			drain(fd, large.size());
+		}))
+	{
+		r->counters.push_back({ "mb_per_sec", 4 * 1e3 / r->nsPerOp * 1e6 });
+	}
+
+	if (BenchResult* r = ctx.run("redirect/here_input_4mb_tmpfile", [&]() {
+			char path[] = "/tmp/shell_bench_heredoc.XXXXXX";
+			int fd = mkstemp(path);
+			if (fd == -1) std::abort();
+			unlink(path);
+			if (write(fd, large.data(), large.size()) != static_cast<ssize_t>(large.size())) std::abort();
+			lseek(fd, 0, SEEK_SET);
+			drain(fd, large.size());
+		}))
+	{
+		r->counters.push_back({ "mb_per_sec", 4 * 1e3 / r->nsPerOp * 1e6 });
+	}
+}
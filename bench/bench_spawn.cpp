@@ -0,0 +1,44 @@
+#include "bench.hpp"
+#include "executor.hpp"
+#include "variables.hpp"
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <sys/wait.h>
+
+//=============================================================================
+// 进程启动
+//=============================================================================
+
+// 启动 /bin/true 并等待结束
+void spawnTrue(SpawnBackend backend)
+{
+	char arg0[] = "true";
+	char* argv[] = { arg0, nullptr };
+	pid_t pid = spawnProcess("/bin/true", argv, exportedEnvironment(), {}, -1, backend);
+	if (pid <= 0) std::abort();
+	waitpid(pid, nullptr, 0);
+}
+
+void runSpawnBenchmarks(BenchContext& ctx)
+{
+	auto spawnBench = [&](const std::string& name, SpawnBackend backend) {
+		if (BenchResult* r = ctx.run(name, [&]() { spawnTrue(backend); }))
+		{
+			r->counters.push_back({ "cmds_per_sec", 1e9 / r->nsPerOp });
+		}
+	};
+
+	spawnBench("spawn/fork/small_heap", SpawnBackend::Fork);
+	spawnBench("spawn/posix_spawn/small_heap", SpawnBackend::PosixSpawn);
+
+	// 模拟持有大量历史记录和缓存的 shell：fork 需要复制的页表随常驻内存增长
+	if (!ctx.enabled("spawn/fork/heap_256mb") && !ctx.enabled("spawn/posix_spawn/heap_256mb")) return;
+	const size_t heapSize = 256u << 20;
+	std::unique_ptr<char[]> heap(new char[heapSize]);
+	std::memset(heap.get(), 1, heapSize);
+
+	spawnBench("spawn/fork/heap_256mb", SpawnBackend::Fork);
+	spawnBench("spawn/posix_spawn/heap_256mb", SpawnBackend::PosixSpawn);
+}
@@ -0,0 +1,30 @@
+#include "bench.hpp"
+#include "substitution.hpp"
+
+#include <cstdlib>
+#include <string>
+
+//=============================================================================
+// 命令替换
+//=============================================================================
+
+void runSubstitutionBenchmarks(BenchContext& ctx)
+{
+	auto captureBench = [&](const std::string& name, const std::string& command) {
+		if (BenchResult* r = ctx.run(name, [&]() {
+				std::string output = captureOutput(command);
+				if (output.empty()) std::abort();
+			}))
+		{
+			r->counters.push_back({ "subst_per_sec", 1e9 / r->nsPerOp });
+		}
+	};
+
+	// $(pwd)：内置命令在 shell 进程中执行，不 fork
+	captureBench("substitution/builtin_pwd", "pwd");
+	captureBench("substitution/builtin_echo", "echo a b c");
+
+	// 外部命令和管道：fork 子 shell，通过管道读取
+	captureBench("substitution/external_pwd", "/bin/pwd");
+	captureBench("substitution/large_output_1mb", "head -c 1048576 /dev/zero");
+}
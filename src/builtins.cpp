@@ -0,0 +1,389 @@
+#include "builtins.hpp"
+#include "command_lookup.hpp"
+#include "history.hpp"
+#include "jobs.hpp"
+#include "options.hpp"
+#include "parallel.hpp"
+#include "variables.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>     // strerror()
+#include <iostream>
+#include <sstream>
+#include <unistd.h>
+#include <vector>
+
+// 执行 echo 命令（输出到指定文件描述符）
+int executeEcho(const CommandInfo& cmdInfo, int outputFd)
+{
+	for (size_t i = 1; i < cmdInfo.args.size(); ++i)
+	{
+		if (i > 1) write(outputFd, " ", 1);
+
+		if (cmdInfo.args[i].singleQuoted)
+		{
+			write(outputFd, cmdInfo.args[i].value.data(), cmdInfo.args[i].value.length());
+			continue;
+		}
+
+		std::string outputText = decodeEchoEscapes(cmdInfo.args[i].value);
+		write(outputFd, outputText.c_str(), outputText.length());
+	}
+	return write(outputFd, "\n", 1) == 1 ? 0 : 1;
+}
+
+// 执行 type 命令
+int executeType(const std::string& target)
+{
+	if (isBuiltinCommand(target))
+	{
+		std::cout << target << " is a shell builtin" << std::endl;
+		return 0;
+	}
+
+	if (target == "time")
+	{
+		std::cout << target << " is a shell keyword" << std::endl;
+		return 0;
+	}
+
+	// 只查询，不把结果加入哈希表（管道中在 shell 进程内执行时也不影响 shell 状态）
+	std::string execPath = lookupExecutable(target);
+	if (execPath.empty())
+	{
+		std::cout << target << ": not found" << std::endl;
+		return 1;
+	}
+	std::cout << target << " is " << execPath << std::endl;
+	return 0;
+}
+
+// 执行 pwd 命令
+int executePwd()
+{
+	char cwd[4096];
+	if (getcwd(cwd, sizeof(cwd)) == nullptr)
+	{
+		std::cerr << "pwd: " << std::strerror(errno) << std::endl;
+		return 1;
+	}
+	std::cout << cwd << std::endl;
+	return 0;
+}
+
+// 执行 cd 命令
+int executeCd(const CommandInfo& cmdInfo)
+{
+	std::string targetDir;
+	if (cmdInfo.args.size() < 2 || cmdInfo.args[1].value == "~")
+	{
+		// cd 或 cd ~ 跳转到 HOME 目录
+		const std::string* home = getVariable("HOME");
+		if (home != nullptr)
+		{
+			targetDir = *home;
+		}
+	}
+	else
+	{
+		targetDir = std::string(cmdInfo.args[1].value);
+	}
+
+	if (!targetDir.empty() && chdir(targetDir.c_str()) != 0)
+	{
+		std::cerr << "cd: " << targetDir << ": No such file or directory" << std::endl;
+		return 1;
+	}
+	return 0;
+}
+
+// 执行 history 命令
+int executeHistory(const CommandInfo& cmdInfo)
+{
+	// history -r <file>：从文件读取历史记录
+	if (cmdInfo.args.size() >= 3 && cmdInfo.args[1].value == "-r")
+	{
+		loadHistoryFromFile(std::string(cmdInfo.args[2].value));
+		return 0;
+	}
+	
+	// history -w <file>：将历史记录写入文件
+	if (cmdInfo.args.size() >= 3 && cmdInfo.args[1].value == "-w")
+	{
+		saveHistoryToFile(std::string(cmdInfo.args[2].value));
+		return 0;
+	}
+	
+	// history -a <file>：追加新命令到文件
+	if (cmdInfo.args.size() >= 3 && cmdInfo.args[1].value == "-a")
+	{
+		appendHistoryToFile(std::string(cmdInfo.args[2].value), lastAppendedIndex);
+		lastAppendedIndex = commandHistory.sessionCount();
+		return 0;
+	}
+	
+	// history --stats：内存占用
+	if (cmdInfo.args.size() >= 2 && cmdInfo.args[1].value == "--stats")
+	{
+		printHistoryStats();
+		return 0;
+	}
+
+	// 显示历史记录
+	size_t start = 0;
+	size_t count = commandHistory.size();
+	
+	// 检查是否有参数限制显示数量
+	if (cmdInfo.args.size() >= 2)
+	{
+		try
+		{
+			int n = std::stoi(std::string(cmdInfo.args[1].value));
+			if (n > 0 && static_cast<size_t>(n) < commandHistory.size())
+			{
+				start = commandHistory.size() - n;
+			}
+		}
+		catch (...) {} // 无效参数，显示全部
+	}
+	
+	for (size_t i = start; i < count; ++i)
+	{
+		std::cout << "    " << (i + 1) << "  " << commandHistory[i] << std::endl;
+	}
+	return 0;
+}
+
+// 执行 hash 命令
+int executeHash(const CommandInfo& cmdInfo)
+{
+	// hash：列出哈希表
+	if (cmdInfo.args.size() < 2)
+	{
+		if (commandHashTable.empty())
+		{
+			std::cout << "hash: hash table empty" << std::endl;
+			return 0;
+		}
+		std::vector<std::pair<std::string, HashEntry>> entries(commandHashTable.begin(), commandHashTable.end());
+		std::sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+		std::cout << "hits\tcommand" << std::endl;
+		for (const auto& [name, entry] : entries)
+		{
+			std::string hits = std::to_string(entry.hits);
+			std::cout << std::string(hits.length() < 4 ? 4 - hits.length() : 0, ' ') << hits << "\t" << entry.path << std::endl;
+		}
+		return 0;
+	}
+
+	std::string_view option = cmdInfo.args[1].value;
+
+	// hash -r：清空哈希表
+	if (option == "-r")
+	{
+		clearCommandHash();
+		return 0;
+	}
+
+	// hash -d name...：删除指定条目
+	if (option == "-d")
+	{
+		int status = 0;
+		for (size_t i = 2; i < cmdInfo.args.size(); ++i)
+		{
+			if (commandHashTable.erase(std::string(cmdInfo.args[i].value)) == 0)
+			{
+				std::cerr << "hash: " << cmdInfo.args[i].value << ": not found" << std::endl;
+				status = 1;
+			}
+		}
+		return status;
+	}
+
+	// hash -l：以可重新输入的格式列出
+	if (option == "-l")
+	{
+		if (commandHashTable.empty())
+		{
+			std::cout << "hash: hash table empty" << std::endl;
+			return 0;
+		}
+		for (const auto& [name, entry] : commandHashTable)
+		{
+			std::cout << "builtin hash -p " << entry.path << " " << name << std::endl;
+		}
+		return 0;
+	}
+
+	// hash -t name...：显示已记住的路径，不查找
+	if (option == "-t")
+	{
+		int status = 0;
+		for (size_t i = 2; i < cmdInfo.args.size(); ++i)
+		{
+			auto it = commandHashTable.find(std::string(cmdInfo.args[i].value));
+			if (it == commandHashTable.end())
+			{
+				std::cerr << "hash: " << cmdInfo.args[i].value << ": not found" << std::endl;
+				status = 1;
+				continue;
+			}
+			if (cmdInfo.args.size() > 3) std::cout << it->first << "\t";
+			std::cout << it->second.path << std::endl;
+		}
+		return status;
+	}
+
+	// hash -p path name：手动指定路径
+	if (option == "-p")
+	{
+		if (cmdInfo.args.size() < 4)
+		{
+			std::cerr << "hash: -p: option requires an argument" << std::endl;
+			return 2;
+		}
+		commandHashTable[std::string(cmdInfo.args[3].value)] = { std::string(cmdInfo.args[2].value), 0, true };
+		return 0;
+	}
+
+	// hash -s：显示命中率统计
+	if (option == "-s")
+	{
+		double rate = hashStats.lookups ? 100.0 * hashStats.hits / hashStats.lookups : 0.0;
+		std::ostringstream oss;
+		oss.setf(std::ios::fixed);
+		oss.precision(1);
+		oss << "lookups: " << hashStats.lookups << "\n"
+			<< "hits: " << hashStats.hits << "\n"
+			<< "misses: " << hashStats.misses << "\n"
+			<< "invalidations: " << hashStats.invalidations << "\n"
+			<< "hit rate: " << rate << "%\n";
+		std::cout << oss.str();
+		return 0;
+	}
+
+	// hash name...：查找并加入哈希表，不计命中
+	int status = 0;
+	for (size_t i = 1; i < cmdInfo.args.size(); ++i)
+	{
+		std::string name(cmdInfo.args[i].value);
+		if (isBuiltinCommand(name)) continue;
+		if (findExecutable(name, false).empty())
+		{
+			std::cerr << "hash: " << name << ": not found" << std::endl;
+			status = 1;
+		}
+	}
+	return status;
+}
+
+// 执行 shopt 命令
+int executeShopt(const CommandInfo& cmdInfo)
+{
+	auto printOption = [](const ShellOption& option, bool reusable) {
+		if (reusable)
+			std::cout << "shopt " << (*option.value ? "-s " : "-u ") << option.name << std::endl;
+		else
+			std::cout << option.name << "\t" << (*option.value ? "on" : "off") << std::endl;
+	};
+
+	size_t argIndex = 1;
+	int setMode = 0; // 1 = -s, -1 = -u
+	bool reusable = false;
+	while (argIndex < cmdInfo.args.size() && cmdInfo.args[argIndex].value.starts_with("-"))
+	{
+		std::string_view flag = cmdInfo.args[argIndex].value;
+		if (flag == "-s") setMode = 1;
+		else if (flag == "-u") setMode = -1;
+		else if (flag == "-p") reusable = true;
+		else
+		{
+			std::cerr << "shopt: " << flag << ": invalid option" << std::endl;
+			return 2;
+		}
+		argIndex++;
+	}
+
+	// 没有选项名：列出全部
+	if (argIndex >= cmdInfo.args.size())
+	{
+		for (const auto& option : SHELL_OPTIONS)
+		{
+			if (setMode == 0 || *option.value == (setMode > 0)) printOption(option, reusable);
+		}
+		return 0;
+	}
+
+	int status = 0;
+	for (; argIndex < cmdInfo.args.size(); ++argIndex)
+	{
+		std::string name(cmdInfo.args[argIndex].value);
+		const ShellOption* option = findShellOption(name);
+		if (option == nullptr)
+		{
+			std::cerr << "shopt: " << name << ": invalid shell option name" << std::endl;
+			status = 1;
+			continue;
+		}
+		if (setMode != 0)
+			*option->value = setMode > 0;
+		else
+			printOption(*option, reusable);
+	}
+	return status;
+}
+
+// 内置命令是否会修改 shell 自身状态（工作目录、哈希表、选项等）
+bool builtinModifiesShell(const CommandInfo& cmdInfo)
+{
+	std::string_view cmd = cmdInfo.args[0].value;
+	if (cmd == "cd" || cmd == "exit" || cmd == "fg" || cmd == "bg" || cmd == "wait" || cmd == "unset") return true;
+	if (cmd == "export") return cmdInfo.args.size() >= 2 && cmdInfo.args[1].value != "-p";
+	// hash：只有列出（无参数、-l）和查询（-t）不修改哈希表；hash name、-p、-d、-r 都会修改
+	if (cmd == "hash") return cmdInfo.args.size() >= 2 && cmdInfo.args[1].value != "-l" && cmdInfo.args[1].value != "-t";
+	// shopt：只有列出（无参数、-p）是只读的，-s/-u 设置选项
+	if (cmd == "shopt")
+	{
+		for (size_t i = 1; i < cmdInfo.args.size(); ++i)
+		{
+			if (cmdInfo.args[i].value != "-p") return true;
+		}
+		return false;
+	}
+	if (cmd == "history") return cmdInfo.args.size() >= 2 && (cmdInfo.args[1].value == "-r" || cmdInfo.args[1].value == "-a");
+	return false;
+}
+
+// 内置命令是否从 stdin 读取输入（管道中不是第一段时需要在子 shell 中执行，才能接上管道读端）
+bool builtinReadsStdin(const CommandInfo& cmdInfo)
+{
+	return cmdInfo.args[0].value == "parallel" && parallelReadsStdin(cmdInfo);
+}
+
+// 执行管道中的内置命令（在 shell 进程或子进程中，输出到当前 stdout），返回退出状态
+int executeBuiltinInPipeline(const CommandInfo& cmdInfo)
+{
+	std::string_view cmd = cmdInfo.args[0].value;
+
+	if (cmd == "echo") return executeEcho(cmdInfo, STDOUT_FILENO);
+	if (cmd == "type")
+	{
+		if (cmdInfo.args.size() >= 2) return executeType(std::string(cmdInfo.args[1].value));
+		std::cout << "type: missing argument" << std::endl;
+		return 1;
+	}
+	if (cmd == "pwd") return executePwd();
+	if (cmd == "history") return executeHistory(cmdInfo);
+	if (cmd == "hash") return executeHash(cmdInfo);
+	if (cmd == "shopt") return executeShopt(cmdInfo);
+	if (cmd == "cd") return executeCd(cmdInfo);
+	if (cmd == "jobs") return executeJobs(cmdInfo);
+	if (cmd == "parallel") return executeParallel(cmdInfo);
+	if (cmd == "export") return executeExport(cmdInfo);
+	if (cmd == "unset") return executeUnset(cmdInfo);
+	if (cmd == "wait") return executeWait(cmdInfo);
+	// exit 在管道中不退出 shell；fg/bg 在子 shell 中没有作业
+	return 0;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "parser.hpp"
+
+#include <string>
+
+//=============================================================================
+// 内置命令实现（返回退出状态：0 成功，1 失败，2 用法错误）
+//=============================================================================
+
+// 执行 echo 命令（输出到指定文件描述符）
+int executeEcho(const CommandInfo& cmdInfo, int outputFd);
+
+// 执行 type 命令
+int executeType(const std::string& target);
+
+// 执行 pwd 命令
+int executePwd();
+
+// 执行 cd 命令
+int executeCd(const CommandInfo& cmdInfo);
+
+// 执行 history 命令
+int executeHistory(const CommandInfo& cmdInfo);
+
+// 执行 hash 命令
+int executeHash(const CommandInfo& cmdInfo);
+
+// 执行 shopt 命令
+int executeShopt(const CommandInfo& cmdInfo);
+
+// 内置命令是否会修改 shell 自身状态（工作目录、哈希表、选项等）
+// 这类命令在管道中需要子 shell 语义，只有 lastpipe 的最后一段才在 shell 进程中执行
+bool builtinModifiesShell(const CommandInfo& cmdInfo);
+
+// 内置命令是否从 stdin 读取输入（管道中不是第一段时需要在子 shell 中执行，才能接上管道读端）
+bool builtinReadsStdin(const CommandInfo& cmdInfo);
+
+// 执行管道中的内置命令（在 shell 进程或子进程中，输出到当前 stdout），返回退出状态
+int executeBuiltinInPipeline(const CommandInfo& cmdInfo);
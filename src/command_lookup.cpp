@@ -0,0 +1,110 @@
+#include "command_lookup.hpp"
+#include "platform.hpp"
+#include "variables.hpp"
+
+// Builtin commands for autocompletion
+const std::vector<std::string> BUILTIN_COMMANDS = {"echo", "exit", "type", "history", "pwd", "cd", "hash", "shopt", "jobs", "fg", "bg", "wait", "parallel", "export", "unset"};
+
+std::unordered_map<std::string, HashEntry> commandHashTable;
+HashStats hashStats;
+
+// 清空哈希表
+void clearCommandHash()
+{
+	commandHashTable.clear();
+}
+
+// PATH 改变时清空哈希表（由变量赋值、export、unset 通知，查找时不必再比较 PATH）
+void onPathChanged()
+{
+	if (!commandHashTable.empty())
+	{
+		hashStats.invalidations++;
+		clearCommandHash();
+	}
+}
+
+// 逐个扫描 PATH 目录查找可执行文件（不经过哈希表）
+std::string searchPath(const std::string& cmd)
+{
+	const std::string* pathVar = getVariable("PATH");
+	if (pathVar == nullptr) return "";
+	return searchPath(cmd, *pathVar);
+}
+
+// 在给定的冒号分隔目录列表中查找可执行文件
+std::string searchPath(const std::string& cmd, std::string_view path)
+{
+	size_t start = 0;
+	while (true)
+	{
+		size_t end = path.find(PATH_DELIM, start);
+		std::string_view dir = (end == std::string_view::npos)
+			? path.substr(start)
+			: path.substr(start, end - start);
+
+		if (!dir.empty())
+		{
+			std::string fullPath = std::string(dir) + PATH_SEP + cmd;
+			if (access(fullPath.c_str(), X_OK) == 0)
+			{
+				return fullPath;
+			}
+		}
+
+		if (end == std::string_view::npos) break;
+		start = end + 1;
+	}
+
+	return "";
+}
+
+// 在PATH中查找可执行文件，优先使用哈希表
+// countHit 为 false 时不增加命中次数（hash name 等只记住路径、不执行的场景）
+std::string findExecutable(const std::string& cmd, bool countHit)
+{
+	hashStats.lookups++;
+
+	auto it = commandHashTable.find(cmd);
+	if (it != commandHashTable.end())
+	{
+		// 缓存的文件可能已被删除，用一次 access() 校验；hash -p 指定的条目按原样使用
+		if (it->second.manual || access(it->second.path.c_str(), X_OK) == 0)
+		{
+			hashStats.hits++;
+			if (countHit) it->second.hits++;
+			return it->second.path;
+		}
+		hashStats.invalidations++;
+		commandHashTable.erase(it);
+	}
+
+	hashStats.misses++;
+	std::string fullPath = searchPath(cmd);
+	if (!fullPath.empty())
+	{
+		commandHashTable[cmd] = { fullPath, countHit ? 1u : 0u };
+	}
+	return fullPath;
+}
+
+// 只查询可执行文件的路径（type）：使用仍有效的哈希表条目，否则扫描 PATH，不修改哈希表和统计
+std::string lookupExecutable(const std::string& cmd)
+{
+	auto it = commandHashTable.find(cmd);
+	if (it != commandHashTable.end() && (it->second.manual || access(it->second.path.c_str(), X_OK) == 0))
+	{
+		return it->second.path;
+	}
+	return searchPath(cmd);
+}
+
+// 检查是否是内置命令
+bool isBuiltinCommand(const std::string& cmd)
+{
+	for (const auto& builtin : BUILTIN_COMMANDS)
+	{
+		if (cmd == builtin) return true;
+	}
+	return false;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+//=============================================================================
+// 命令查找与检查
+//=============================================================================
+
+// Builtin commands for autocompletion
+extern const std::vector<std::string> BUILTIN_COMMANDS;
+
+// 命令哈希表（类似 bash 的 hash）：命令名 -> 完整路径 + 命中次数
+struct HashEntry
+{
+	std::string path;
+	size_t hits{};
+	bool manual{}; // hash -p 指定：不做可执行检查，直接执行并报告真实的错误（如 Permission denied）
+};
+
+extern std::unordered_map<std::string, HashEntry> commandHashTable;
+
+// 哈希表统计计数器（hash -s 显示）
+struct HashStats
+{
+	size_t lookups{};       // 查找总次数
+	size_t hits{};          // 命中次数
+	size_t misses{};        // 未命中，需要扫描 PATH
+	size_t invalidations{}; // 因 PATH 改变或文件消失导致的失效次数
+};
+
+extern HashStats hashStats;
+
+// 清空哈希表
+void clearCommandHash();
+
+// PATH 改变时清空哈希表（由变量赋值、export、unset 通知）
+void onPathChanged();
+
+// 逐个扫描 PATH 目录查找可执行文件（不经过哈希表）
+std::string searchPath(const std::string& cmd);
+
+// 在给定的冒号分隔目录列表中查找可执行文件（如命令前的 PATH=... 赋值，不经过哈希表）
+std::string searchPath(const std::string& cmd, std::string_view path);
+
+// 在PATH中查找可执行文件，优先使用哈希表
+// countHit 为 false 时不增加命中次数（hash name 等只记住路径、不执行的场景）
+std::string findExecutable(const std::string& cmd, bool countHit = true);
+
+// 只查询可执行文件的路径（type）：使用仍有效的哈希表条目，否则扫描 PATH，不修改哈希表和统计
+std::string lookupExecutable(const std::string& cmd);
+
+// 检查是否是内置命令
+bool isBuiltinCommand(const std::string& cmd);
@@ -0,0 +1,388 @@
+#include "completion.hpp"
+#include "command_lookup.hpp"
+#include "glob.hpp"
+#include "platform.hpp"
+#include "variables.hpp"
+
+#include <algorithm>   // sort
+#include <atomic>      // 并行扫描 PATH 的任务计数
+#include <cstdlib>
+#include <dirent.h>    // DT_DIR / DT_LNK / DT_UNKNOWN
+#include <fcntl.h>     // open(O_DIRECTORY), pipe2()
+#include <filesystem>
+#include <future>      // 后台构建补全索引
+#include <sys/stat.h>  // stat() - 检测 PATH 目录 mtime
+#include <thread>
+#include <unistd.h>
+
+// 计算多个字符串的最长公共前缀
+std::string longestCommonPrefix(const std::set<std::string>& strings)
+{
+	if (strings.empty()) return "";
+	if (strings.size() == 1) return *strings.begin();
+	
+	// 取第一个字符串作为参考
+	const std::string& first = *strings.begin();
+	size_t prefixLen = first.length();
+	
+	for (const auto& s : strings)
+	{
+		size_t i = 0;
+		while (i < prefixLen && i < s.length() && first[i] == s[i])
+		{
+			i++;
+		}
+		prefixLen = i;
+	}
+	
+	return first.substr(0, prefixLen);
+}
+
+CompletionIndex completionIndex;
+
+// 把 PATH 拆分成目录列表
+std::vector<std::string> splitPathEnv(const std::string& pathStr)
+{
+	std::vector<std::string> dirs;
+	size_t start = 0;
+	while (true)
+	{
+		size_t end = pathStr.find(PATH_DELIM, start);
+		std::string dir = (end == std::string::npos)
+			? pathStr.substr(start)
+			: pathStr.substr(start, end - start);
+		if (!dir.empty()) dirs.push_back(dir);
+
+		if (end == std::string::npos) break;
+		start = end + 1;
+	}
+	return dirs;
+}
+
+// 扫描一个目录中的可执行文件
+std::vector<std::string> scanExecutables(const std::string& dir)
+{
+	std::vector<std::string> names;
+	try
+	{
+		for (const auto& entry : std::filesystem::directory_iterator(dir))
+		{
+			if (entry.is_regular_file() && access(entry.path().c_str(), X_OK) == 0)
+			{
+				names.push_back(entry.path().filename().string());
+			}
+		}
+	}
+	catch (...) {} // Ignore errors when reading directory
+	return names;
+}
+
+// 刷新单个目录：只做一次 stat，mtime 变化才重新扫描，返回内容是否改变
+bool refreshDirIndex(PathDirIndex& d)
+{
+	struct stat st;
+	if (stat(d.dir.c_str(), &st) != 0 || !S_ISDIR(st.st_mode))
+	{
+		bool changed = d.scanned || !d.names.empty();
+		d.scanned = false;
+		d.names.clear();
+		return changed;
+	}
+
+	if (d.scanned && d.mtime.tv_sec == st.st_mtim.tv_sec && d.mtime.tv_nsec == st.st_mtim.tv_nsec)
+	{
+		return false;
+	}
+
+	d.names = scanExecutables(d.dir);
+	d.mtime = st.st_mtim;
+	d.scanned = true;
+	return true;
+}
+
+// 把各目录的文件名合并成有序去重数组
+void mergeCompletionIndex(CompletionIndex& index)
+{
+	std::vector<std::string> merged;
+	for (const auto& d : index.dirs)
+	{
+		merged.insert(merged.end(), d.names.begin(), d.names.end());
+	}
+	std::sort(merged.begin(), merged.end());
+	merged.erase(std::unique(merged.begin(), merged.end()), merged.end());
+	index.names = std::move(merged);
+}
+
+// 完整构建索引：多个工作线程并行扫描各 PATH 目录
+CompletionIndex buildCompletionIndex(const std::string& pathStr)
+{
+	CompletionIndex index;
+	index.pathEnv = pathStr;
+	for (const auto& dir : splitPathEnv(pathStr))
+	{
+		index.dirs.push_back({ dir });
+	}
+
+	std::atomic<size_t> next{ 0 };
+	auto worker = [&]() {
+		for (size_t i = next++; i < index.dirs.size(); i = next++)
+		{
+			refreshDirIndex(index.dirs[i]);
+		}
+	};
+
+	size_t numWorkers = std::min<size_t>(index.dirs.size(), std::max(1u, std::thread::hardware_concurrency()));
+	std::vector<std::thread> workers;
+	for (size_t i = 1; i < numWorkers; ++i)
+	{
+		workers.emplace_back(worker);
+	}
+	worker(); // 当前线程也参与扫描
+	for (auto& t : workers)
+	{
+		t.join();
+	}
+
+	mergeCompletionIndex(index);
+	return index;
+}
+
+// 启动时在后台线程构建的索引，第一次补全时取用
+std::future<CompletionIndex> pendingCompletionIndex;
+
+// 在后台开始扫描 PATH（main() 启动时调用）
+void startBackgroundIndexScan()
+{
+	const std::string* pathVar = getVariable("PATH");
+	std::string pathStr = pathVar ? *pathVar : "";
+	pendingCompletionIndex = std::async(std::launch::async, buildCompletionIndex, pathStr);
+}
+
+// 刷新补全索引
+void refreshCompletionIndex()
+{
+	// 后台扫描尚未取用：必要时等待其完成（通常启动后早已完成）
+	if (pendingCompletionIndex.valid())
+	{
+		completionIndex = pendingCompletionIndex.get();
+	}
+
+	const std::string* pathVar = getVariable("PATH");
+	std::string pathStr = pathVar ? *pathVar : "";
+	bool changed = false;
+
+	// PATH 改变：按新顺序重建目录列表，已扫描过的目录沿用旧缓存
+	if (pathStr != completionIndex.pathEnv || completionIndex.dirs.empty())
+	{
+		std::vector<PathDirIndex> newDirs;
+		for (const auto& dir : splitPathEnv(pathStr))
+		{
+			auto it = std::find_if(completionIndex.dirs.begin(), completionIndex.dirs.end(),
+				[&](const PathDirIndex& d) { return d.dir == dir; });
+			if (it != completionIndex.dirs.end())
+				newDirs.push_back(std::move(*it));
+			else
+				newDirs.push_back({ dir });
+		}
+		completionIndex.dirs = std::move(newDirs);
+		completionIndex.pathEnv = pathStr;
+		changed = true;
+	}
+
+	for (auto& d : completionIndex.dirs)
+	{
+		if (refreshDirIndex(d)) changed = true;
+	}
+
+	if (changed)
+	{
+		mergeCompletionIndex(completionIndex);
+	}
+}
+
+// 返回以 prefix 开头的所有可执行文件名（有序）
+std::vector<std::string> lookupExecutablePrefix(const std::string& prefix)
+{
+	refreshCompletionIndex();
+
+	const auto& names = completionIndex.names;
+	auto first = std::lower_bound(names.begin(), names.end(), prefix);
+	auto last = first;
+	while (last != names.end() && last->compare(0, prefix.length(), prefix) == 0)
+	{
+		++last;
+	}
+	return std::vector<std::string>(first, last);
+}
+
+// 命令名补全：返回以 prefix 开头的内置命令和 PATH 中的可执行文件（有序去重）
+std::set<std::string> completeCommandName(const std::string& prefix)
+{
+	std::set<std::string> matches; // 使用 set 自动排序和去重
+
+	// First check builtin commands
+	for (const auto& cmd : BUILTIN_COMMANDS)
+	{
+		if (cmd.rfind(prefix, 0) == 0) // starts with input
+		{
+			matches.insert(cmd);
+		}
+	}
+
+	// Then check executables in PATH
+	for (const auto& name : lookupExecutablePrefix(prefix))
+	{
+		matches.insert(name);
+	}
+
+	return matches;
+}
+
+
+//=============================================================================
+// 参数位置的文件名补全（后台扫描）
+//=============================================================================
+
+// 后台扫描线程 -> 编辑器的通知管道，第一次开始扫描时创建
+int completionNotifyPipe[2] = { -1, -1 };
+
+// 后台扫描有新结果或完成时变为可读（self-pipe），编辑器等待按键时同时等待它；尚未开始过扫描时为 -1
+int completionNotifyFd()
+{
+	return completionNotifyPipe[0];
+}
+
+// 读空通知管道
+void drainCompletionNotify()
+{
+	char buf[64];
+	while (read(completionNotifyPipe[0], buf, sizeof(buf)) > 0) {}
+}
+
+// 去掉单词中的反斜杠转义和引号，得到实际的路径文本
+std::string unescapeCompletionWord(std::string_view word)
+{
+	std::string text;
+	char quote = 0;
+	for (size_t i = 0; i < word.length(); ++i)
+	{
+		char c = word[i];
+		if (quote)
+		{
+			if (c == quote) quote = 0;
+			else if (quote == '"' && c == '\\' && i + 1 < word.length() && std::string_view("\"\\$`").find(word[i + 1]) != std::string_view::npos) text += word[++i];
+			else text += c;
+		}
+		else if (c == '\'' || c == '"') quote = c;
+		else if (c == '\\' && i + 1 < word.length()) text += word[++i];
+		else text += c;
+	}
+	return text;
+}
+
+// 把文件名转义成可以直接插入命令行的形式
+// 解析器可以反斜杠转义的字符（空格、引号、$、`、通配符）前加 \，操作符等其它特殊字符单独放在单引号中
+std::string escapeCompletionWord(std::string_view name)
+{
+	static constexpr std::string_view ESCAPABLE = " \t'\"\\$`*?[";
+	static constexpr std::string_view OPERATORS = "&;|()<>#\n";
+	std::string escaped;
+	escaped.reserve(name.length());
+	for (char c : name)
+	{
+		if (ESCAPABLE.find(c) != std::string_view::npos)
+		{
+			escaped += '\\';
+			escaped += c;
+		}
+		else if (OPERATORS.find(c) != std::string_view::npos)
+		{
+			escaped += '\'';
+			escaped += c;
+			escaped += '\'';
+		}
+		else escaped += c;
+	}
+	return escaped;
+}
+
+// 后台线程：每次 getdents64 读一批条目，批次之间检查取消标志，有新匹配就通知编辑器
+void scanCompletionDirectory(std::shared_ptr<FileCompletion> completion)
+{
+	// 小批量读取：慢速文件系统上也能尽快看到部分结果
+	constexpr size_t BUFFER_SIZE = 32 * 1024;
+	auto notify = [&completion]() {
+		char byte = 0;
+		if (!completion->cancelled) write(completionNotifyPipe[1], &byte, 1); // 非阻塞：管道满时丢弃
+	};
+
+	// 打开目录本身也可能很慢（NFS 挂载点），同样放在后台线程中
+	const std::string& dir = completion->dir;
+	int fd = open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd == -1)
+	{
+		completion->done = true;
+		notify();
+		return;
+	}
+
+	const std::string& prefix = completion->prefix;
+	bool showHidden = prefix.starts_with('.');
+	std::unique_ptr<char[]> buffer = std::make_unique<char[]>(BUFFER_SIZE);
+	std::vector<std::string> batch;
+	auto addEntry = [&](std::string_view name, unsigned char type) {
+		if (!name.starts_with(prefix) || (name.starts_with('.') && !showHidden)) return;
+
+		std::string match(name);
+		// 符号链接和 d_type 未知时需要 stat 才知道是不是目录（指向目录的链接也补全成目录）
+		bool isDir = type == DT_DIR;
+		struct stat st;
+		if ((type == DT_LNK || type == DT_UNKNOWN) && !completion->cancelled
+			&& fstatat(fd, match.c_str(), &st, 0) == 0 && S_ISDIR(st.st_mode))
+		{
+			isDir = true;
+		}
+		if (isDir) match += '/';
+		batch.push_back(std::move(match));
+	};
+
+	while (!completion->cancelled && readDirectoryBatch(fd, buffer.get(), BUFFER_SIZE, addEntry))
+	{
+		if (batch.empty()) continue;
+		{
+			std::lock_guard<std::mutex> lock(completion->mutex);
+			for (auto& match : batch)
+			{
+				completion->matches.insert(std::move(match));
+			}
+		}
+		batch.clear();
+		notify();
+	}
+	close(fd);
+
+	completion->done = true;
+	notify();
+}
+
+// 在后台线程开始扫描 dir 中以 prefix 开头的条目（以 . 开头的条目只在 prefix 以 . 开头时列出）
+std::shared_ptr<FileCompletion> startFileCompletion(const std::string& dir, const std::string& prefix)
+{
+	if (completionNotifyPipe[0] == -1)
+	{
+		pipe2(completionNotifyPipe, O_CLOEXEC | O_NONBLOCK);
+	}
+
+	auto completion = std::make_shared<FileCompletion>();
+	completion->dir = dir;
+	completion->prefix = prefix;
+	// 分离线程：取消后不等待它退出（可能正阻塞在慢速文件系统上），shared_ptr 保证结构在线程结束前有效
+	std::thread(scanCompletionDirectory, completion).detach();
+	return completion;
+}
+
+// 取消扫描：后台线程在下一批条目之前退出，不再发送通知
+void cancelFileCompletion(const std::shared_ptr<FileCompletion>& completion)
+{
+	if (completion) completion->cancelled = true;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//=============================================================================
+// PATH 可执行文件补全索引
+//=============================================================================
+
+// 单个 PATH 目录的缓存：目录 mtime 不变就不重新扫描
+// 注意：目录 mtime 只在增删/重命名文件时改变，单纯 chmod +x 不会触发刷新
+struct PathDirIndex
+{
+	std::string dir;
+	bool scanned{};
+	struct timespec mtime{};
+	std::vector<std::string> names;
+};
+
+// 所有 PATH 目录合并后的有序、去重文件名数组，补全时用二分查找前缀区间
+struct CompletionIndex
+{
+	std::string pathEnv;
+	std::vector<PathDirIndex> dirs;
+	std::vector<std::string> names;
+};
+
+// 计算多个字符串的最长公共前缀
+std::string longestCommonPrefix(const std::set<std::string>& strings);
+
+// 把 PATH 拆分成目录列表
+std::vector<std::string> splitPathEnv(const std::string& pathStr);
+
+// 完整构建索引：多个工作线程并行扫描各 PATH 目录
+CompletionIndex buildCompletionIndex(const std::string& pathStr);
+
+// 在后台开始扫描 PATH（main() 启动时调用）
+void startBackgroundIndexScan();
+
+// 刷新补全索引
+void refreshCompletionIndex();
+
+// 返回以 prefix 开头的所有可执行文件名（有序）
+std::vector<std::string> lookupExecutablePrefix(const std::string& prefix);
+
+// 命令名补全：返回以 prefix 开头的内置命令和 PATH 中的可执行文件（有序去重）
+std::set<std::string> completeCommandName(const std::string& prefix);
+
+//=============================================================================
+// 参数位置的文件名补全（后台扫描）
+//=============================================================================
+
+// 一次文件名补全：后台线程逐批读取 dir，匹配项边读边加入 matches，编辑器不会因为大目录或慢速文件系统卡住
+// 编辑器可以随时查看已有的部分结果，用户继续输入时取消
+struct FileCompletion
+{
+	std::string dir;               // 扫描的目录（已去掉转义），空表示当前目录
+	std::string prefix;            // 文件名前缀（已去掉转义）
+	std::mutex mutex;              // 保护 matches
+	std::set<std::string> matches; // 以 prefix 开头的文件名（不含目录部分），目录末尾带 '/'
+	std::atomic<bool> done{};
+	std::atomic<bool> cancelled{};
+
+	// 已完成的扫描能否直接用于同一目录下更长的前缀（不必重新读目录）
+	bool covers(const std::string& otherDir, const std::string& otherPrefix) const
+	{
+		return done && !cancelled && dir == otherDir && otherPrefix.starts_with(prefix)
+			&& (prefix.starts_with('.') || !otherPrefix.starts_with('.'));
+	}
+};
+
+// 去掉单词中的反斜杠转义和引号，得到实际的路径文本
+std::string unescapeCompletionWord(std::string_view word);
+
+// 把文件名转义成可以直接插入命令行的形式（反斜杠转义，操作符放在单引号中）
+std::string escapeCompletionWord(std::string_view name);
+
+// 在后台线程开始扫描 dir 中以 prefix 开头的条目（以 . 开头的条目只在 prefix 以 . 开头时列出）
+std::shared_ptr<FileCompletion> startFileCompletion(const std::string& dir, const std::string& prefix);
+
+// 取消扫描：后台线程在下一批条目之前退出，不再发送通知
+void cancelFileCompletion(const std::shared_ptr<FileCompletion>& completion);
+
+// 后台扫描有新结果或完成时变为可读（self-pipe），编辑器等待按键时同时等待它；尚未开始过扫描时为 -1
+int completionNotifyFd();
+
+// 读空通知管道
+void drainCompletionNotify();
@@ -0,0 +1,1263 @@
+#include "executor.hpp"
+#include "builtins.hpp"
+#include "command_lookup.hpp"
+#include "glob.hpp"
+#include "jobs.hpp"
+#include "options.hpp"
+#include "parallel.hpp"
+#include "substitution.hpp"
+#include "variables.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>    // from_chars() - N>&M 中的 M
+#include <cstdio>      // snprintf()
+#include <cstdlib>
+#include <csignal>     // sigaction()
+#include <cstring>     // strerror()
+#include <fcntl.h>     // open() - 新增用于文件操作
+#include <climits>     // PIPE_BUF
+#include <iostream>
+#include <spawn.h>     // posix_spawn()
+#include <sys/mman.h>  // memfd_create()
+#include <sys/uio.h>   // writev()
+#include <sys/time.h>  // timersub()
+#include <sys/wait.h>  // waitpid(), wait4()
+#include <unistd.h>    // fork(), execve(), access(), X_OK
+
+// 最近一条命令的退出状态（$?），也是 shell 的退出码（exit N 直接设置它）
+int shellExitStatus = 0;
+
+// 打开重定向的文件（< > >> <>），带 O_CLOEXEC
+int openRedirectFile(const Redirect& redirect)
+{
+	int flags = O_CLOEXEC;
+	switch (redirect.kind)
+	{
+	case RedirectKind::Input: flags |= O_RDONLY; break;
+	case RedirectKind::Output: flags |= O_WRONLY | O_CREAT | O_TRUNC; break;
+	case RedirectKind::Append: flags |= O_WRONLY | O_CREAT | O_APPEND; break;
+	case RedirectKind::ReadWrite: flags |= O_RDWR | O_CREAT; break;
+	default:
+		errno = EINVAL;
+		return -1;
+	}
+	return open(redirect.target.data(), flags, 0644); // 文件名以 '\0' 结尾
+}
+
+// 通过变量 SHELL_SPAWN_BACKEND=fork|posix_spawn 在运行时选择，默认 posix_spawn
+SpawnBackend currentSpawnBackend()
+{
+	const std::string* backend = getVariable("SHELL_SPAWN_BACKEND");
+	if (backend != nullptr && *backend == "fork")
+	{
+		return SpawnBackend::Fork;
+	}
+	return SpawnBackend::PosixSpawn;
+}
+
+// 解析 SHELL_PIPE_SIZE 的值：字节数，可带 k/m 后缀；无效时返回 0，超过 pipe-max-size 时取上限
+int parsePipeSize(std::string_view text)
+{
+	// 非特权进程不能超过 pipe-max-size（默认 1MB），启动后只读一次（fd 同样带 O_CLOEXEC）
+	static const long maxSize = []() {
+		long value = 1024 * 1024;
+		int fd = open("/proc/sys/fs/pipe-max-size", O_RDONLY | O_CLOEXEC);
+		if (fd != -1)
+		{
+			char buf[32];
+			ssize_t n = read(fd, buf, sizeof(buf));
+			close(fd);
+			long parsed = 0;
+			if (n > 0 && std::from_chars(buf, buf + n, parsed).ec == std::errc() && parsed > 0) value = parsed;
+		}
+		return std::min<long>(value, INT_MAX);
+	}();
+
+	long size = 0;
+	auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), size);
+	if (ec == std::errc::result_out_of_range) size = LONG_MAX; // 超出 long 的数字同样取上限
+	else if (ec != std::errc() || size <= 0) return 0;
+	std::string_view suffix(end, text.data() + text.size() - end);
+	long unit = 1;
+	if (suffix == "k" || suffix == "K") unit = 1024;
+	else if (suffix == "m" || suffix == "M") unit = 1024 * 1024;
+	else if (!suffix.empty()) return 0;
+
+	// 先与上限比较再相乘，避免用户输入的大数溢出
+	if (size > maxSize / unit) return static_cast<int>(maxSize);
+	return static_cast<int>(size * unit);
+}
+
+// 命令前的 SHELL_PIPE_SIZE=... 优先于 shell 变量，多次赋值时最后一个生效（与 PATH=... 相同）
+int pipeBufferSize(const CommandInfo& first)
+{
+	constexpr std::string_view name = "SHELL_PIPE_SIZE=";
+	for (auto it = first.assignments.rbegin(); it != first.assignments.rend(); ++it)
+	{
+		if (it->starts_with(name)) return parsePipeSize(it->substr(name.size()));
+	}
+	const std::string* value = getVariable("SHELL_PIPE_SIZE");
+	return value != nullptr ? parsePipeSize(*value) : 0;
+}
+
+bool createPipe(int fds[2], int size)
+{
+	if (pipe2(fds, O_CLOEXEC) == -1) return false;
+	if (size > 0) fcntl(fds[1], F_SETPIPE_SZ, size); // 内核向上取整到 2 的幂个页
+	return true;
+}
+
+// here-document / here-string 的内容作为标准输入：小的写入管道，大的写入 memfd
+int openHereInput(std::string_view text, bool newline)
+{
+	struct iovec parts[2] = {
+		{ const_cast<char*>(text.data()), text.size() },
+		{ const_cast<char*>("\n"), newline ? 1u : 0u }
+	};
+	size_t total = text.size() + parts[1].iov_len;
+
+	// 不超过 PIPE_BUF 的内容一定能一次写入空管道：读端交给命令，写端立即关闭
+	if (total <= PIPE_BUF)
+	{
+		int pipeFds[2];
+		if (pipe2(pipeFds, O_CLOEXEC) == -1) return -1;
+		ssize_t n = writev(pipeFds[1], parts, 2);
+		close(pipeFds[1]);
+		if (n != static_cast<ssize_t>(total))
+		{
+			close(pipeFds[0]);
+			return -1;
+		}
+		return pipeFds[0];
+	}
+
+	// 大的内容：管道需要写线程与命令并发，memfd 只需一次拷贝，命令从头读取
+	int fd = memfd_create("here-document", MFD_CLOEXEC);
+	if (fd == -1) return -1;
+	struct iovec* part = parts;
+	int count = 2;
+	while (count > 0)
+	{
+		ssize_t n = writev(fd, part, count);
+		if (n == -1 && errno == EINTR) continue;
+		if (n <= 0)
+		{
+			close(fd);
+			return -1;
+		}
+		// 部分写入：跳过已写完的部分
+		size_t written = static_cast<size_t>(n);
+		while (count > 0 && written >= part->iov_len)
+		{
+			written -= part->iov_len;
+			part++;
+			count--;
+		}
+		if (count > 0)
+		{
+			part->iov_base = static_cast<char*>(part->iov_base) + written;
+			part->iov_len -= written;
+		}
+	}
+	lseek(fd, 0, SEEK_SET);
+	return fd;
+}
+
+// 依次应用 actions 之后 fd 是否打开：由最后一个以它为目标的操作决定，没有时看 shell 自己的 fd
+bool fdOpenAfter(int fd, const std::vector<FdAction>& actions)
+{
+	for (auto it = actions.rbegin(); it != actions.rend(); ++it)
+	{
+		if (it->targetFd == fd) return it->srcFd != -1;
+	}
+	return fcntl(fd, F_GETFD) != -1;
+}
+
+// 在父进程中按顺序打开各重定向的文件，生成子进程需要的 fd 操作
+// 打开的 fd 追加到 openedFds，由调用者在启动子进程后关闭
+bool openRedirects(const CommandInfo& cmdInfo, std::vector<FdAction>& actions, std::vector<int>& openedFds)
+{
+	for (const Redirect& redirect : cmdInfo.redirects)
+	{
+		if (redirect.kind == RedirectKind::Duplicate)
+		{
+			// N>&M：M 必须是打开的 fd（可以是前面的重定向刚设置的），M 为 - 时关闭 N
+			if (redirect.target == "-")
+			{
+				actions.push_back({ -1, redirect.fd });
+				continue;
+			}
+			int src = -1;
+			auto [end, ec] = std::from_chars(redirect.target.data(), redirect.target.data() + redirect.target.size(), src);
+			if (ec != std::errc() || end != redirect.target.data() + redirect.target.size() || src < 0 || !fdOpenAfter(src, actions))
+			{
+				std::cerr << redirect.target << ": " << std::strerror(EBADF) << std::endl;
+				return false;
+			}
+			actions.push_back({ src, redirect.fd });
+			continue;
+		}
+
+		bool hereInput = redirect.kind == RedirectKind::HereDocument || redirect.kind == RedirectKind::HereString;
+		int fd = hereInput ? openHereInput(redirect.target, redirect.kind == RedirectKind::HereString) : openRedirectFile(redirect);
+		if (fd == -1)
+		{
+			std::cerr << (redirect.kind == RedirectKind::HereDocument ? "here-document" : redirect.target) << ": "
+				<< std::strerror(errno) << std::endl;
+			return false;
+		}
+
+		// 新打开的 fd 恰好是某个重定向的目标（如 3>a 中 a 被打开为 3）：先移开，否则会被按顺序执行的 dup2 覆盖
+		bool isTarget = std::any_of(cmdInfo.redirects.begin(), cmdInfo.redirects.end(),
+			[fd](const Redirect& other) { return other.fd == fd; });
+		if (isTarget)
+		{
+			int moved = fcntl(fd, F_DUPFD_CLOEXEC, 10);
+			close(fd);
+			if (moved == -1)
+			{
+				std::cerr << redirect.target << ": " << std::strerror(errno) << std::endl;
+				return false;
+			}
+			fd = moved;
+		}
+		openedFds.push_back(fd);
+		actions.push_back({ fd, redirect.fd });
+	}
+	return true;
+}
+
+// 子进程（fork 之后、exec 之前）中依次执行 fd 操作
+void applyFdActions(const std::vector<FdAction>& actions)
+{
+	for (const auto& action : actions)
+	{
+		if (action.srcFd == -1)
+			close(action.targetFd);
+		else if (action.srcFd == action.targetFd)
+			fcntl(action.targetFd, F_SETFD, 0); // N>&N：保持打开，exec 之后也有效
+		else
+			dup2(action.srcFd, action.targetFd);
+	}
+}
+
+// 关闭父进程打开的 fd
+void closeFds(const std::vector<int>& fds)
+{
+	for (int fd : fds)
+	{
+		close(fd);
+	}
+}
+
+// 子进程（fork 之后）：加入进程组，恢复 shell 忽略的作业控制信号
+void setupChildJobControl(pid_t pgid)
+{
+	if (pgid >= 0) setpgid(0, pgid);
+	if (!jobControlEnabled) return;
+	sigset_t signals = jobControlSignals();
+	for (int sig = 1; sig < NSIG; ++sig)
+	{
+		if (sigismember(&signals, sig) == 1) signal(sig, SIG_DFL);
+	}
+}
+
+// 启动子进程执行 path，环境为 envp，成功返回 pid，失败返回 -1 并设置 errno
+pid_t spawnProcess(const std::string& path, char* const argv[], char* const envp[], const std::vector<FdAction>& actions,
+	pid_t pgid, SpawnBackend backend)
+{
+	if (backend == SpawnBackend::Fork)
+	{
+		pid_t pid = fork();
+		if (pid == 0)
+		{
+			setupChildJobControl(pgid);
+
+			// 子进程：处理重定向
+			applyFdActions(actions);
+			execve(path.c_str(), argv, envp);
+			// parallel 的工作线程也经由这里 fork：其它线程可能在 fork 时持有 iostream 的锁，
+			// 子进程只用 write 报告错误（strerrordesc_np 返回静态文本，不依赖 locale）
+			const char* message = strerrordesc_np(errno);
+			struct iovec parts[4] = {
+				{ argv[0], std::strlen(argv[0]) },
+				{ const_cast<char*>(": "), 2 },
+				{ const_cast<char*>(message), message != nullptr ? std::strlen(message) : 0 },
+				{ const_cast<char*>("\n"), 1 }
+			};
+			int err = errno;
+			writev(STDERR_FILENO, parts, 4);
+			// 与 bash 一致：找不到为 127，存在但无法执行为 126
+			_exit(err == ENOENT ? 127 : 126);
+		}
+		// 父进程也设置一次，避免 tcsetpgrp 时子进程还没来得及加入进程组
+		if (pid > 0 && pgid >= 0) setpgid(pid, pgid == 0 ? pid : pgid);
+		return pid;
+	}
+
+	posix_spawn_file_actions_t fileActions;
+	posix_spawn_file_actions_init(&fileActions);
+	for (const auto& action : actions)
+	{
+		if (action.srcFd == -1)
+			posix_spawn_file_actions_addclose(&fileActions, action.targetFd);
+		else
+			posix_spawn_file_actions_adddup2(&fileActions, action.srcFd, action.targetFd);
+	}
+
+	// 进程组和信号处理由 posix_spawn 在 exec 之前设置好
+	posix_spawnattr_t attr;
+	posix_spawnattr_init(&attr);
+	short flags = 0;
+	if (pgid >= 0)
+	{
+		posix_spawnattr_setpgroup(&attr, pgid);
+		flags |= POSIX_SPAWN_SETPGROUP;
+	}
+	if (jobControlEnabled)
+	{
+		sigset_t signals = jobControlSignals();
+		posix_spawnattr_setsigdefault(&attr, &signals);
+		flags |= POSIX_SPAWN_SETSIGDEF;
+	}
+	posix_spawnattr_setflags(&attr, flags);
+
+	pid_t pid = -1;
+	int err = posix_spawn(&pid, path.c_str(), &fileActions, &attr, argv, envp);
+	posix_spawn_file_actions_destroy(&fileActions);
+	posix_spawnattr_destroy(&attr);
+
+	if (err != 0)
+	{
+		errno = err;
+		return -1;
+	}
+	return pid;
+}
+
+//=============================================================================
+// 子进程回收与资源统计
+//=============================================================================
+
+// 等待各阶段的子进程结束，记录退出状态、结束时间和资源使用
+// 按结束顺序回收（wait4(-1)），每个阶段的耗时是它真正结束的时刻，而不是轮到它被 waitpid 的时刻
+// 期间结束的后台作业进程交给作业表记录
+bool waitForStages(std::vector<StageUsage>& stages)
+{
+	int options = jobControlEnabled ? WUNTRACED : 0;
+	size_t remaining = 0;
+	for (const auto& stage : stages)
+	{
+		if (stage.pid > 0) remaining++;
+	}
+
+	while (remaining > 0)
+	{
+		int status = 0;
+		struct rusage usage;
+		pid_t pid = wait4(-1, &status, options, &usage);
+		if (pid == -1)
+		{
+			if (errno == EINTR) continue;
+			break;
+		}
+
+		auto end = std::chrono::steady_clock::now();
+		auto stage = std::find_if(stages.begin(), stages.end(), [pid](const StageUsage& s) { return s.pid == pid; });
+		if (stage == stages.end())
+		{
+			noteChildStatus(pid, status);
+			continue;
+		}
+
+		// Ctrl-Z：整个前台作业已被挂起
+		if (WIFSTOPPED(status)) return false;
+
+		stage->status = status;
+		stage->usage = usage;
+		stage->wallSeconds = std::chrono::duration<double>(end - stage->start).count();
+		stage->finished = true;
+		remaining--;
+	}
+	return true;
+}
+
+// 前台作业被信号终止时报告
+void reportForegroundSignal(const std::vector<StageUsage>& stages)
+{
+	const StageUsage& last = stages.back();
+	if (last.pid > 0 && last.finished) reportSignalStatus(last.status);
+}
+
+// 前台作业被挂起：尚未结束的进程作为 Stopped 作业加入作业表
+void recordStoppedJob(const std::vector<StageUsage>& stages, pid_t pgid, const std::string& command)
+{
+	std::vector<pid_t> pids;
+	for (const auto& stage : stages)
+	{
+		if (stage.pid > 0 && !stage.finished) pids.push_back(stage.pid);
+	}
+	Job& job = addJob(pgid, pids, stages.back().pid, command, JobState::Stopped);
+	std::cout << std::endl;
+	printJobStatus(job);
+}
+
+// 两次 getrusage 之间的 CPU 时间增量
+struct rusage rusageDelta(const struct rusage& before, const struct rusage& after)
+{
+	struct rusage delta{};
+	timersub(&after.ru_utime, &before.ru_utime, &delta.ru_utime);
+	timersub(&after.ru_stime, &before.ru_stime, &delta.ru_stime);
+	delta.ru_maxrss = 0; // shell 自身的峰值内存与命令无关，只统计子进程
+	return delta;
+}
+
+double timevalSeconds(const struct timeval& tv)
+{
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+// bash 格式：0m0.123s
+std::string formatDuration(double seconds)
+{
+	char buf[64];
+	int minutes = static_cast<int>(seconds / 60);
+	std::snprintf(buf, sizeof(buf), "%dm%.3fs", minutes, seconds - minutes * 60);
+	return buf;
+}
+
+// 输出 time 报告：整体的 real/user/sys/maxrss，管道时再列出每个阶段
+// self 为 shell 进程自身在此期间的资源增量（内置命令在 shell 内执行）
+void printTimeReport(double wallSeconds, const std::vector<StageUsage>& stages, const struct rusage& self)
+{
+	double user = timevalSeconds(self.ru_utime);
+	double sys = timevalSeconds(self.ru_stime);
+	long maxRss = self.ru_maxrss;
+	for (const auto& stage : stages)
+	{
+		if (stage.inProcess) continue; // 已包含在 self 中
+		user += timevalSeconds(stage.usage.ru_utime);
+		sys += timevalSeconds(stage.usage.ru_stime);
+		maxRss = std::max(maxRss, stage.usage.ru_maxrss);
+	}
+
+	std::string report;
+	report += "\nreal\t" + formatDuration(wallSeconds) + "\n";
+	report += "user\t" + formatDuration(user) + "\n";
+	report += "sys\t" + formatDuration(sys) + "\n";
+	report += "maxrss\t" + std::to_string(maxRss) + "KB\n";
+
+	// 管道：逐阶段列出，便于找出瓶颈
+	if (stages.size() > 1)
+	{
+		report += "stage\treal\tuser\tsys\tmaxrss\tcommand\n";
+		for (size_t i = 0; i < stages.size(); ++i)
+		{
+			const StageUsage& stage = stages[i];
+			char line[256];
+			std::snprintf(line, sizeof(line), "%zu\t%.3fs\t%.3fs\t%.3fs\t%ldKB\t", i + 1, stage.wallSeconds,
+				timevalSeconds(stage.usage.ru_utime), timevalSeconds(stage.usage.ru_stime), stage.usage.ru_maxrss);
+			const char* note = stage.inProcess ? " (builtin)" : stage.pid > 0 ? "" : " (not run)";
+			report += line + stage.command + note + "\n";
+		}
+	}
+
+	std::cerr << report;
+}
+
+//=============================================================================
+// 外部命令执行
+//=============================================================================
+
+// 启动外部命令（不等待）：actions（如管道）之后应用命令自身的重定向，构建 argv 并 spawn
+// 失败时输出错误，重定向失败返回 LAUNCH_REDIRECT_FAILED，无法执行返回 LAUNCH_NOT_EXECUTABLE，启动失败返回 -1
+pid_t launchExternal(const std::string& execPath, const CommandInfo& cmdInfo, std::vector<FdAction> actions, pid_t pgid)
+{
+	std::vector<int> openedFds;
+	if (!openRedirects(cmdInfo, actions, openedFds))
+	{
+		closeFds(openedFds);
+		return LAUNCH_REDIRECT_FAILED;
+	}
+
+	// 构建参数数组（直接指向解析结果，无需复制）
+	std::vector<char*> args = buildArgv(cmdInfo);
+
+	// 环境：平时直接使用缓存的导出变量，只有带前缀赋值时才构建新的数组
+	std::vector<char*> envWithAssignments;
+	char* const* envp = exportedEnvironment();
+	if (!cmdInfo.assignments.empty())
+	{
+		envWithAssignments = environmentWith(cmdInfo.assignments);
+		envp = envWithAssignments.data();
+	}
+
+	pid_t pid = spawnProcess(execPath, args.data(), envp, actions, pgid);
+	int err = errno;
+	closeFds(openedFds);
+	if (pid <= 0)
+	{
+		std::cerr << cmdInfo.args[0].value << ": " << std::strerror(err) << std::endl;
+		// fork/spawn 本身资源不足不算无法执行
+		if (err != ENOENT && err != EAGAIN && err != ENOMEM) return LAUNCH_NOT_EXECUTABLE;
+	}
+	return pid;
+}
+
+// 查找外部命令：命令前有 PATH=... 赋值时按该 PATH 查找（最后一个生效），结果不放入哈希表
+std::string findCommandPath(const CommandInfo& cmdInfo)
+{
+	std::string name(cmdInfo.args[0].value);
+	constexpr std::string_view pathPrefix = "PATH=";
+	for (auto it = cmdInfo.assignments.rbegin(); it != cmdInfo.assignments.rend(); ++it)
+	{
+		if (it->starts_with(pathPrefix)) return searchPath(name, it->substr(pathPrefix.size()));
+	}
+	return findExecutable(name);
+}
+
+// 执行外部命令
+bool executeExternal(const CommandInfo& cmdInfo, StageUsage* stage)
+{
+	std::string execPath = findCommandPath(cmdInfo);
+	if (execPath.empty())
+	{
+		std::cout << cmdInfo.args[0].value << ": command not found" << std::endl;
+		return false;
+	}
+
+	std::vector<StageUsage> stages(1);
+	stages[0].command = cmdInfo.args[0].value;
+	stages[0].start = std::chrono::steady_clock::now();
+	pid_t pid = launchExternal(execPath, cmdInfo, {}, jobControlEnabled ? 0 : -1);
+	if (pid == LAUNCH_REDIRECT_FAILED)
+	{
+		// 与 { ...; } 的重定向失败一样，退出状态为 1
+		stages[0].finished = true;
+		stages[0].status = 1 << 8;
+		if (stage != nullptr) *stage = stages[0];
+		return true;
+	}
+	if (pid == LAUNCH_NOT_EXECUTABLE)
+	{
+		stages[0].finished = true;
+		stages[0].status = 126 << 8;
+		if (stage != nullptr) *stage = stages[0];
+		return true;
+	}
+
+	if (pid > 0)
+	{
+		stages[0].pid = pid;
+		// 作业控制：前台进程组获得终端，Ctrl-C / Ctrl-Z 只发给它
+		giveTerminalTo(pid);
+		bool finished = waitForStages(stages);
+		reclaimTerminal();
+		if (finished)
+			reportForegroundSignal(stages);
+		else
+			recordStoppedJob(stages, pid, describeCommands({ cmdInfo }));
+	}
+
+	if (stage != nullptr) *stage = stages[0];
+	return pid > 0;
+}
+
+//=============================================================================
+// 管道执行
+//=============================================================================
+
+// 在 shell 进程中应用重定向：先 actions（如管道写端），再命令自身的重定向
+bool redirectShellFds(const CommandInfo& cmdInfo, std::vector<FdAction> actions, SavedShellFds& saved)
+{
+	if (!openRedirects(cmdInfo, actions, saved.openedFds))
+	{
+		closeFds(saved.openedFds);
+		saved.openedFds.clear();
+		return false;
+	}
+
+	std::cout.flush();
+	std::cerr.flush();
+	for (const auto& action : actions)
+	{
+		// 每个 fd 第一次被重定向时保存原来的副本（没有打开则记为 -1，恢复时关闭）
+		int target = action.targetFd;
+		bool alreadySaved = std::any_of(saved.fds.begin(), saved.fds.end(), [target](const FdAction& s) { return s.targetFd == target; });
+		if (!alreadySaved)
+		{
+			saved.fds.push_back({ fcntl(target, F_DUPFD_CLOEXEC, 10), target });
+		}
+		if (action.srcFd == -1)
+			close(target);
+		else
+			dup2(action.srcFd, target);
+	}
+	return true;
+}
+
+// 恢复 redirectShellFds 之前的各 fd
+void restoreShellFds(SavedShellFds& saved)
+{
+	std::cout.flush();
+	std::cerr.flush();
+	std::cout.clear();
+	std::cerr.clear();
+
+	for (auto it = saved.fds.rbegin(); it != saved.fds.rend(); ++it)
+	{
+		if (it->srcFd == -1)
+		{
+			close(it->targetFd);
+			continue;
+		}
+		dup2(it->srcFd, it->targetFd);
+		close(it->srcFd);
+	}
+	saved.fds.clear();
+	closeFds(saved.openedFds);
+	saved.openedFds.clear();
+}
+
+// 在 shell 进程中执行管道里的内置命令：临时把 stdout 指向管道写端（outputFd，-1 表示不变）
+// 并应用命令自身的重定向，执行完恢复 0/1/2。内置命令不读 stdin，所以不接管道读端
+void runBuiltinInProcess(const CommandInfo& cmdInfo, int outputFd, StageUsage& stage)
+{
+	std::vector<FdAction> actions;
+	if (outputFd != -1) actions.push_back({ outputFd, STDOUT_FILENO });
+
+	SavedShellFds saved;
+	if (!redirectShellFds(cmdInfo, std::move(actions), saved))
+	{
+		stage.status = 1 << 8;
+		return;
+	}
+
+	stage.start = std::chrono::steady_clock::now();
+	struct rusage before, after;
+	getrusage(RUSAGE_SELF, &before);
+
+	// 读端已关闭时写入返回 EPIPE，而不是让 SIGPIPE 杀死 shell
+	struct sigaction ignorePipe{}, oldPipe;
+	ignorePipe.sa_handler = SIG_IGN;
+	sigaction(SIGPIPE, &ignorePipe, &oldPipe);
+
+	stage.status = (executeBuiltinInPipeline(cmdInfo) & 0xff) << 8;
+
+	restoreShellFds(saved);
+	sigaction(SIGPIPE, &oldPipe, nullptr);
+
+	getrusage(RUSAGE_SELF, &after);
+	stage.usage = rusageDelta(before, after);
+	stage.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - stage.start).count();
+}
+
+// 子 shell（fork 出的子进程）中执行内置命令或复合命令，返回退出状态
+// 子 shell 没有作业控制：其中启动的命令留在子 shell 的进程组里，不争夺终端
+int runInSubshell(const ParsedLine& parsed, const CommandInfo& cmdInfo)
+{
+	jobControlEnabled = false;
+	jobTable.clear();
+
+	std::vector<FdAction> actions;
+	std::vector<int> openedFds;
+	if (!openRedirects(cmdInfo, actions, openedFds)) return 1;
+	applyFdActions(actions);
+	closeFds(openedFds);
+
+	if (cmdInfo.body < 0) return executeBuiltinInPipeline(cmdInfo);
+	executeList(parsed, parsed.lists[cmdInfo.body]);
+	return shellExitStatus;
+}
+
+// 执行管道命令，返回退出状态
+int executePipeline(const ParsedLine& parsed, const std::vector<CommandInfo>& pipeCommands, std::vector<StageUsage>* stagesOut,
+	bool background)
+{
+	int numCmds = pipeCommands.size();
+	std::vector<int> pipeFds((numCmds - 1) * 2);
+
+	// 创建所有管道（O_CLOEXEC：exec 后子进程只保留 dup2 到 0/1 的那一端）
+	// 大流量管道（zcat | grep | sort）可以用 SHELL_PIPE_SIZE 加大缓冲区，减少各阶段之间的切换
+	int pipeSize = numCmds > 1 ? pipeBufferSize(pipeCommands[0]) : 0;
+	for (int i = 0; i < numCmds - 1; ++i)
+	{
+		if (!createPipe(&pipeFds[i * 2], pipeSize))
+		{
+			std::cerr << "pipe failed" << std::endl;
+			return 1;
+		}
+	}
+
+	std::vector<StageUsage> stages(numCmds);
+	std::vector<int> inProcessStages;
+	// 作业控制：整条管道一个进程组，组长为第一个启动的进程
+	pid_t pgid = jobControlEnabled ? 0 : -1;
+
+	for (int i = 0; i < numCmds; ++i)
+	{
+		const CommandInfo& cmdInfo = pipeCommands[i];
+		bool isCompound = cmdInfo.body >= 0;
+		if (!isCompound && cmdInfo.args.empty())
+		{
+			// 只有赋值：管道的各段相当于子 shell，赋值不影响 shell，也不需要进程，状态为 0
+			stages[i].finished = true;
+			continue;
+		}
+		std::string cmdName = isCompound ? describeCommands({ cmdInfo }) : std::string(cmdInfo.args[0].value);
+		stages[i].command = cmdName;
+		stages[i].start = std::chrono::steady_clock::now();
+		bool isBuiltin = !isCompound && isBuiltinCommand(cmdName);
+		std::string execPath;
+
+		// 不修改 shell 状态的内置命令（echo、type、pwd、history 等）不需要 fork，
+		// 等外部命令全部启动后在 shell 进程中执行；会修改状态的（cd、hash -r 等）
+		// 保持子 shell 语义，只有开启 lastpipe 时的最后一段才在 shell 进程中执行
+		// 后台作业中的内置命令一律在子 shell 中执行，不阻塞 shell
+		// 读 stdin 的内置命令（parallel）不在第一段时也 fork，shell 内执行时不接管道读端
+		if (isBuiltin && !background && (i == 0 || !builtinReadsStdin(cmdInfo)) &&
+			(!builtinModifiesShell(cmdInfo) || (optLastpipe && i == numCmds - 1)))
+		{
+			stages[i].inProcess = true;
+			inProcessStages.push_back(i);
+			continue;
+		}
+
+		if (!isBuiltin && !isCompound)
+		{
+			execPath = findCommandPath(cmdInfo);
+			if (execPath.empty())
+			{
+				std::cerr << cmdName << ": command not found" << std::endl;
+				continue;
+			}
+
+			// 外部命令：管道 dup2 之后再应用该命令自身的重定向
+			std::vector<FdAction> actions;
+			if (i > 0) actions.push_back({ pipeFds[(i - 1) * 2], STDIN_FILENO });
+			if (i < numCmds - 1) actions.push_back({ pipeFds[i * 2 + 1], STDOUT_FILENO });
+
+			pid_t pid = launchExternal(execPath, cmdInfo, std::move(actions), pgid);
+			if (pid > 0)
+			{
+				stages[i].pid = pid;
+				if (pgid == 0) pgid = pid;
+			}
+			else if (pid == LAUNCH_REDIRECT_FAILED)
+			{
+				stages[i].finished = true;
+				stages[i].status = 1 << 8;
+			}
+			else if (pid == LAUNCH_NOT_EXECUTABLE)
+			{
+				stages[i].finished = true;
+				stages[i].status = 126 << 8;
+			}
+			continue;
+		}
+
+		// 修改 shell 状态的内置命令和复合命令：fork 出子 shell 执行，不影响当前 shell
+		pid_t pid = fork();
+		if (pid == 0)
+		{
+			// 管道执行流程详解：
+
+			// 假设执行 "cmd0 | cmd1 | cmd2"（3个命令，2个管道）
+
+			// 管道数组结构：
+			// pipeFds[0] = 管道0读端    pipeFds[1] = 管道0写端
+			// pipeFds[2] = 管道1读端    pipeFds[3] = 管道1写端
+
+			// 数据流向：
+			// cmd0 ---> 管道0 ---> cmd1 ---> 管道1 ---> cmd2
+			// 	写端[1]    读端[0]  写端[3]    读端[2]
+
+			// 各命令的重定向：
+			// cmd0 (i=0): stdin=终端,        stdout=pipeFds[1] (管道0写端)
+			// cmd1 (i=1): stdin=pipeFds[0],  stdout=pipeFds[3] (管道1写端)
+			// cmd2 (i=2): stdin=pipeFds[2],  stdout=终端
+
+			// 索引计算公式：
+			// 读取前一个管道: pipeFds[(i-1)*2]   -> 读端
+			// 写入当前管道:   pipeFds[i*2+1]     -> 写端
+
+			// fork() 返回值：
+			// 子进程中返回 0
+			// 父进程中返回子进程PID
+			// 失败返回 -1
+
+			// dup2(oldFd, newFd) 作用：
+			// 将 newFd 重定向到 oldFd，之后对 newFd 的操作实际作用于 oldFd
+
+			// 为什么要关闭所有管道文件描述符：
+			// 1. dup2 已复制了需要的描述符
+			// 2. 不关闭写端会导致读端无法检测 EOF
+			// 3. 避免文件描述符泄漏
+
+			// 图解示例： cat file | wc
+			// 命令0: cat file          命令1: wc
+			// 	i=0                     i=1
+
+			// [stdin]                 pipeFds[0] ──→ [stdin]
+			// 	↓                         ↑              ↓
+			// cat                      管道0            wc
+			// 	↓                         ↑              ↓
+			// [stdout] ──→ pipeFds[1] ────┘          [stdout]
+			// cat (i=0)：
+
+			// 不重定向 stdin（i=0，跳过）
+			// stdout → pipeFds[1]（管道0写端）
+			// wc (i=1)：
+
+			// stdin ← pipeFds[0]（管道0读端）
+			// 不重定向 stdout（i=1 是最后一个，跳过）
+
+			// 子进程
+			setupChildJobControl(pgid);
+
+			// 如果不是第一个命令，从前一个管道读取
+			if (i > 0)
+			{
+				dup2(pipeFds[(i - 1) * 2], STDIN_FILENO);
+			}
+
+			// 如果不是最后一个命令，写入到下一个管道
+			if (i < numCmds - 1)
+			{
+				dup2(pipeFds[i * 2 + 1], STDOUT_FILENO);
+			}
+
+			// 关闭所有管道文件描述符
+			for (size_t j = 0; j < pipeFds.size(); ++j)
+			{
+				close(pipeFds[j]);
+			}
+
+			// 执行内置命令或复合命令（不运行 exit 的清理函数，shell 的后台线程不在子进程中）
+			int status = runInSubshell(parsed, cmdInfo);
+			std::cout.flush();
+			_exit(status);
+		}
+		else if (pid > 0)
+		{
+			stages[i].pid = pid;
+			if (pgid >= 0) setpgid(pid, pgid == 0 ? pid : pgid);
+			if (pgid == 0) pgid = pid;
+		}
+	}
+
+	// 父进程关闭所有管道，只保留 shell 内执行的内置命令要写入的写端
+	for (int i = 0; i < numCmds - 1; ++i)
+	{
+		close(pipeFds[i * 2]);
+		if (!stages[i].inProcess) close(pipeFds[i * 2 + 1]);
+	}
+
+	if (background)
+	{
+		// 后台作业：交互模式下报告作业号和最后一个进程的 pid，不等待
+		std::vector<pid_t> pids;
+		for (const auto& stage : stages)
+		{
+			if (stage.pid > 0) pids.push_back(stage.pid);
+		}
+		if (!pids.empty())
+		{
+			Job& job = addJob(pgid > 0 ? pgid : pids[0], pids, stages.back().pid, describeCommands(pipeCommands), JobState::Running);
+			lastBackgroundPid = pids.back();
+			if (jobControlEnabled) std::cout << "[" << job.id << "] " << pids.back() << std::endl;
+		}
+		return 0;
+	}
+
+	// 外部命令启动后即把终端交给管道的进程组，shell 内执行的内置命令照常输出
+	if (pgid > 0) giveTerminalTo(pgid);
+
+	for (int i : inProcessStages)
+	{
+		runBuiltinInProcess(pipeCommands[i], i < numCmds - 1 ? pipeFds[i * 2 + 1] : -1, stages[i]);
+		if (i < numCmds - 1) close(pipeFds[i * 2 + 1]);
+	}
+
+	// 等待所有子进程
+	bool finished = waitForStages(stages);
+	if (pgid > 0) reclaimTerminal();
+	if (finished)
+		reportForegroundSignal(stages);
+	else
+		recordStoppedJob(stages, pgid, describeCommands(pipeCommands));
+
+	// 管道的退出状态是最后一段的状态；没能启动的命令为 127，无法执行为 126，重定向失败为 1
+	const StageUsage& last = stages.back();
+	int status = 127;
+	if (!finished)
+		status = 128 + SIGTSTP;
+	else if (last.inProcess || last.pid > 0 || last.finished)
+		status = exitCodeFromStatus(last.status);
+
+	if (stagesOut != nullptr) *stagesOut = std::move(stages);
+	return status;
+}
+
+//=============================================================================
+// 命令行执行
+//=============================================================================
+
+// 只有赋值的命令 NAME=value...：设置 shell 变量（已导出的变量同时更新环境）
+// 重定向照常创建文件
+int assignVariables(const CommandInfo& cmdInfo)
+{
+	std::vector<FdAction> actions;
+	std::vector<int> openedFds;
+	bool opened = openRedirects(cmdInfo, actions, openedFds);
+	closeFds(openedFds);
+	if (!opened) return 1;
+
+	for (std::string_view assignment : cmdInfo.assignments)
+	{
+		size_t eq = assignment.find('=');
+		setVariable(assignment.substr(0, eq), assignment.substr(eq + 1));
+	}
+	return 0;
+}
+
+// 执行一条简单命令（内置命令直接在 shell 进程中执行），子进程的执行结果追加到 stages，遇到 exit 返回 false
+// 命令前的赋值只作用于外部命令的环境，内置命令忽略它们
+bool executeSimpleCommand(const CommandInfo& cmdInfo, std::vector<StageUsage>& stages)
+{
+	std::string_view cmd = cmdInfo.args[0].value;
+
+	// 处理 exit 命令：没有参数时以最近一条命令的状态退出
+	if (cmd == "exit")
+	{
+		if (cmdInfo.args.size() >= 2)
+		{
+			try
+			{
+				shellExitStatus = std::stoi(std::string(cmdInfo.args[1].value)) & 0xff;
+			}
+			catch (...) {} // 无效参数，保持原退出码
+		}
+		return false;
+	}
+
+	// 内置命令的重定向临时作用于 shell 自己的 fd（如 pwd > f、parallel 读取 here-document）
+	bool builtin = isBuiltinCommand(std::string(cmd));
+	bool redirected = builtin && !cmdInfo.redirects.empty();
+	SavedShellFds saved;
+	if (redirected && !redirectShellFds(cmdInfo, {}, saved))
+	{
+		shellExitStatus = 1;
+		return true;
+	}
+
+	// 处理内置命令
+	int status = 0;
+	if (cmd == "history")
+	{
+		status = executeHistory(cmdInfo);
+	}
+	else if (cmd == "pwd")
+	{
+		status = executePwd();
+	}
+	else if (cmd == "cd")
+	{
+		status = executeCd(cmdInfo);
+	}
+	else if (cmd == "hash")
+	{
+		status = executeHash(cmdInfo);
+	}
+	else if (cmd == "shopt")
+	{
+		status = executeShopt(cmdInfo);
+	}
+	else if (cmd == "jobs")
+	{
+		status = executeJobs(cmdInfo);
+	}
+	else if (cmd == "fg")
+	{
+		status = executeFg(cmdInfo);
+	}
+	else if (cmd == "bg")
+	{
+		status = executeBg(cmdInfo);
+	}
+	else if (cmd == "wait")
+	{
+		status = executeWait(cmdInfo);
+	}
+	else if (cmd == "parallel")
+	{
+		status = executeParallel(cmdInfo);
+	}
+	else if (cmd == "export")
+	{
+		status = executeExport(cmdInfo);
+	}
+	else if (cmd == "unset")
+	{
+		status = executeUnset(cmdInfo);
+	}
+	else if (cmd == "echo")
+	{
+		status = executeEcho(cmdInfo, STDOUT_FILENO);
+	}
+	else if (cmd == "type")
+	{
+		if (cmdInfo.args.size() < 2)
+		{
+			std::cout << "type: missing argument" << std::endl;
+			status = 1;
+		}
+		else
+		{
+			status = executeType(std::string(cmdInfo.args[1].value));
+		}
+	}
+	else
+	{
+		// 处理外部命令：找不到或无法启动为 127，无法执行为 126，重定向失败为 1，被挂起为 128 + SIGTSTP
+		StageUsage stage;
+		status = 127;
+		if (executeExternal(cmdInfo, &stage))
+		{
+			stages.push_back(stage);
+			status = stage.finished ? exitCodeFromStatus(stage.status) : 128 + SIGTSTP;
+		}
+	}
+
+	if (redirected) restoreShellFds(saved);
+	shellExitStatus = status;
+	return true;
+}
+
+// 在 shell 进程中执行 { list; }：命令自身的重定向作用于整个列表
+// 子进程的资源使用按 RUSAGE_CHILDREN 的增量记为一个阶段（供 time 使用）
+bool executeGroup(const ParsedLine& parsed, const CommandInfo& cmdInfo, std::vector<StageUsage>& stages)
+{
+	SavedShellFds saved;
+	if (!redirectShellFds(cmdInfo, {}, saved))
+	{
+		shellExitStatus = 1;
+		return true;
+	}
+
+	StageUsage stage;
+	stage.command = describeCommands({ cmdInfo });
+	stage.start = std::chrono::steady_clock::now();
+	struct rusage before, after;
+	getrusage(RUSAGE_CHILDREN, &before);
+
+	bool keepRunning = executeList(parsed, parsed.lists[cmdInfo.body]);
+
+	getrusage(RUSAGE_CHILDREN, &after);
+	restoreShellFds(saved);
+	stage.usage = rusageDelta(before, after);
+	stage.usage.ru_maxrss = after.ru_maxrss;
+	stage.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - stage.start).count();
+	stage.status = (shellExitStatus & 0xff) << 8;
+	stage.finished = true;
+	stages.push_back(stage);
+	return keepRunning;
+}
+
+// 执行一条管道（简单命令、复合命令或多段管道），子进程的执行结果追加到 stages，遇到 exit 返回 false
+bool executePipelineNode(const ParsedLine& parsed, const Pipeline& pipeline, std::vector<StageUsage>& stages)
+{
+	// 替换和路径名：启动管道之前依次展开
+	const std::vector<CommandInfo>* commands = &pipeline.commands;
+	ExpandedCommands expanded;
+	if (needsExpansion(pipeline.commands))
+	{
+		expandCommands(pipeline.commands, expanded);
+		commands = &expanded.commands;
+		if (commands->empty()) return true; // 只有替换、没有命令：退出状态为最后一个替换的状态
+	}
+
+	const CommandInfo& first = (*commands)[0];
+	if (commands->size() > 1 || first.subshell)
+	{
+		shellExitStatus = executePipeline(parsed, *commands, &stages);
+		return true;
+	}
+	if (first.body >= 0) return executeGroup(parsed, first, stages);
+	if (first.args.empty())
+	{
+		// 只有赋值：有命令替换时退出状态为最后一个命令替换的状态
+		const std::vector<Substitution>& substitutions = pipeline.commands[0].substitutions;
+		bool captured = std::any_of(substitutions.begin(), substitutions.end(),
+			[](const Substitution& substitution) { return !substitution.variable; });
+		int status = assignVariables(first);
+		if (status != 0 || !captured) shellExitStatus = status;
+		return true;
+	}
+	return executeSimpleCommand(first, stages);
+}
+
+// 执行一条管道（处理 time 关键字），遇到 exit 返回 false
+bool executeTimedPipeline(const ParsedLine& parsed, const Pipeline& pipeline)
+{
+	if (!pipeline.timed)
+	{
+		std::vector<StageUsage> stages;
+		return executePipelineNode(parsed, pipeline, stages);
+	}
+
+	// time：记录墙钟时间，子进程资源来自 wait4，内置命令的开销来自 shell 自身的 getrusage 增量
+	struct rusage selfBefore, selfAfter;
+	getrusage(RUSAGE_SELF, &selfBefore);
+	auto start = std::chrono::steady_clock::now();
+
+	std::vector<StageUsage> stages;
+	bool keepRunning = executePipelineNode(parsed, pipeline, stages);
+
+	double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	getrusage(RUSAGE_SELF, &selfAfter);
+	printTimeReport(wallSeconds, stages, rusageDelta(selfBefore, selfAfter));
+	return keepRunning;
+}
+
+// 执行 and-or 列表 pipelines[begin, end)：&& 在前一条成功时执行，|| 在前一条失败时执行
+// 跳过的管道不改变退出状态，所以 a && b || c 在 a 失败时执行 c
+bool executeAndOr(const ParsedLine& parsed, const std::vector<Pipeline>& pipelines, size_t begin, size_t end)
+{
+	for (size_t i = begin; i < end; ++i)
+	{
+		const Pipeline& pipeline = pipelines[i];
+		if (i > begin && pipeline.connector == Connector::And && shellExitStatus != 0) continue;
+		if (i > begin && pipeline.connector == Connector::Or && shellExitStatus == 0) continue;
+		if (!executeTimedPipeline(parsed, pipeline)) return false;
+	}
+	return true;
+}
+
+// 后台执行 and-or 列表：单条管道直接作为后台作业启动，
+// 多条管道或有命令替换时 fork 出子 shell 执行整个列表（替换也在后台展开），子 shell 作为一个作业
+void executeBackground(const ParsedLine& parsed, const std::vector<Pipeline>& pipelines, size_t begin, size_t end)
+{
+	shellExitStatus = 0;
+	if (end - begin == 1 && !hasSubstitutions(pipelines[begin].commands))
+	{
+		// 路径名展开没有副作用，在 shell 中完成
+		const std::vector<CommandInfo>* commands = &pipelines[begin].commands;
+		ExpandedCommands expanded;
+		if (needsExpansion(*commands))
+		{
+			expandCommands(*commands, expanded);
+			commands = &expanded.commands;
+		}
+		if (!commands->empty()) executePipeline(parsed, *commands, nullptr, true);
+		return;
+	}
+
+	std::string command;
+	for (size_t i = begin; i < end; ++i)
+	{
+		if (i > begin) command += pipelines[i].connector == Connector::And ? " && " : " || ";
+		command += describeCommands(pipelines[i].commands);
+	}
+
+	pid_t pgid = jobControlEnabled ? 0 : -1;
+	pid_t pid = fork();
+	if (pid == 0)
+	{
+		setupChildJobControl(pgid);
+		jobControlEnabled = false;
+		jobTable.clear();
+		executeAndOr(parsed, pipelines, begin, end);
+		std::cout.flush();
+		_exit(shellExitStatus);
+	}
+	if (pid == -1)
+	{
+		std::cerr << "fork: " << std::strerror(errno) << std::endl;
+		shellExitStatus = 1;
+		return;
+	}
+
+	if (pgid >= 0) setpgid(pid, pid);
+	Job& job = addJob(pid, { pid }, pid, command, JobState::Running);
+	lastBackgroundPid = pid;
+	if (jobControlEnabled) std::cout << "[" << job.id << "] " << pid << std::endl;
+}
+
+// 执行命令列表，遇到 exit 返回 false；退出状态记录在 shellExitStatus
+bool executeList(const ParsedLine& parsed, const CommandList& list)
+{
+	const std::vector<Pipeline>& pipelines = list.pipelines;
+	size_t begin = 0;
+	while (begin < pipelines.size())
+	{
+		// and-or 列表：直到下一条以 ; & 分隔的管道为止
+		size_t end = begin + 1;
+		while (end < pipelines.size() && pipelines[end].connector != Connector::Sequence) end++;
+
+		if (pipelines[end - 1].background)
+			executeBackground(parsed, pipelines, begin, end);
+		else if (!executeAndOr(parsed, pipelines, begin, end))
+			return false;
+		begin = end;
+	}
+	return true;
+}
+
+// 依次读取各 here-document 的正文：后续各行直到定界符所在的行
+void readHereDocuments(ParsedLine& parsed, const LineReader& readLine)
+{
+	std::string line;
+	std::string body;
+	for (size_t i = 0; i < parsed.hereDocuments.size(); ++i)
+	{
+		const HereDocument& document = parsed.hereDocuments[i];
+		body.clear();
+		bool terminated = false;
+		while (readLine && readLine(line))
+		{
+			// <<-：去掉开头的 tab（全是 tab 的行变为空行）
+			if (document.stripTabs) line.erase(0, line.find_first_not_of('\t'));
+			if (line == document.delimiter)
+			{
+				terminated = true;
+				break;
+			}
+			body += line;
+			body += '\n';
+		}
+		if (!terminated)
+		{
+			std::cerr << "warning: here-document delimited by end-of-file (wanted `" << document.delimiter << "')" << std::endl;
+		}
+		setHereDocumentBody(parsed, i, body);
+	}
+}
+
+// 执行一行命令，遇到 exit 返回 false
+bool executeCommandLine(const std::string& command, const LineReader& readLine)
+{
+	// 非交互模式不报告作业状态，只回收已结束的后台作业
+	if (!jobControlEnabled) notifyJobChanges();
+
+	ParsedLine parsed;
+	parseLine(command, parsed);
+	// 语法错误时也要读掉正文，不把它们当作命令执行
+	readHereDocuments(parsed, readLine);
+	if (parsed.syntaxError)
+	{
+		if (parsed.errorToken.empty())
+			std::cerr << "syntax error: unexpected end of file" << std::endl;
+		else
+			std::cerr << "syntax error near unexpected token `" << parsed.errorToken << "'" << std::endl;
+		shellExitStatus = 2;
+		return true;
+	}
+
+	// 路径名展开读取的目录列表只在这一行命令执行期间缓存
+	clearGlobCache();
+	bool keepRunning = executeList(parsed, parsed.lists[0]);
+	clearGlobCache();
+	return keepRunning;
+}
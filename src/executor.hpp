@@ -0,0 +1,135 @@
+#pragma once
+
+#include "parser.hpp"
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <vector>
+
+//=============================================================================
+// 外部命令执行
+//=============================================================================
+
+// 进程启动后端：fork + execv，或 posix_spawn（glibc 内部使用 CLONE_VM|CLONE_VFORK，
+// 不需要复制父进程页表，shell 内存越大优势越明显）
+enum class SpawnBackend
+{
+	Fork,
+	PosixSpawn
+};
+
+// 通过环境变量 SHELL_SPAWN_BACKEND=fork|posix_spawn 在运行时选择，默认 posix_spawn
+SpawnBackend currentSpawnBackend();
+
+// 管道缓冲区大小：变量 SHELL_PIPE_SIZE（字节数，可带 k/m 后缀），写在管道第一条命令前的
+// SHELL_PIPE_SIZE=... 只作用于这一条管道。上限为 /proc/sys/fs/pipe-max-size，未设置或无效时返回 0（内核默认 64KB）
+int pipeBufferSize(const CommandInfo& first);
+
+// 创建带 O_CLOEXEC 的管道，size > 0 时用 F_SETPIPE_SZ 调整缓冲区（超出用户配额等失败时保持默认大小）
+bool createPipe(int fds[2], int size);
+
+// 子进程中的文件描述符操作：dup2(srcFd, targetFd)，srcFd 为 -1 时 close(targetFd)
+// 按顺序执行，srcFd 可以是前面的操作刚设置的 fd（2>&1）
+// 父进程打开的源 fd 均带 O_CLOEXEC，exec 时自动关闭，无需额外 close
+struct FdAction
+{
+	int srcFd;
+	int targetFd;
+};
+
+// 管道中一个阶段的执行结果：退出状态和资源使用（由 wait4 获得）
+struct StageUsage
+{
+	std::string command;  // 命令名，用于 time 报告
+	pid_t pid{ -1 };
+	int status{};         // waitpid 格式的状态
+	struct rusage usage{};
+	std::chrono::steady_clock::time_point start;
+	double wallSeconds{};
+	bool inProcess{};     // 内置命令在 shell 进程中执行，usage 为 shell 自身的增量
+	bool finished{};      // 已被回收（作业挂起时区分哪些进程还活着）
+};
+
+// 最近一条命令的退出状态（$?），也是 shell 的退出码（exit N 直接设置它）
+extern int shellExitStatus;
+
+// 打开重定向的文件（< > >> <>），带 O_CLOEXEC
+int openRedirectFile(const Redirect& redirect);
+
+// here-document / here-string 的内容作为标准输入：小于管道原子写入长度时写入管道（一次写完，无需写线程），
+// 否则写入 memfd 并回到开头（不落盘，也不需要清理临时文件）。newline 时在内容之后加换行（<<<）
+int openHereInput(std::string_view text, bool newline);
+
+// 在父进程中按顺序打开各重定向的文件，生成子进程需要的 fd 操作（追加在 actions 已有的管道操作之后）
+// 打开的 fd 追加到 openedFds，由调用者在启动子进程后关闭；失败时输出错误并返回 false
+bool openRedirects(const CommandInfo& cmdInfo, std::vector<FdAction>& actions, std::vector<int>& openedFds);
+
+// 关闭父进程打开的 fd
+void closeFds(const std::vector<int>& fds);
+
+// shell 进程中被临时重定向的 fd：原来的副本保存在这里，执行完按相反顺序恢复
+struct SavedShellFds
+{
+	std::vector<FdAction> fds; // { 原来的副本（-1 表示原来没有打开）, 被重定向的 fd }
+	std::vector<int> openedFds;
+};
+
+// 在 shell 进程中应用重定向（内置命令、{ } 复合命令）：先 actions（如管道写端），再命令自身的重定向
+bool redirectShellFds(const CommandInfo& cmdInfo, std::vector<FdAction> actions, SavedShellFds& saved);
+
+// 恢复 redirectShellFds 之前的各 fd
+void restoreShellFds(SavedShellFds& saved);
+
+// 子进程（fork 之后）：pgid >= 0 时加入进程组，恢复 shell 忽略的作业控制信号
+void setupChildJobControl(pid_t pgid);
+
+// 启动子进程执行 path，环境为 envp，成功返回 pid，失败返回 -1 并设置 errno
+// pgid >= 0 时子进程加入该进程组（0 表示以自己为组长），作业控制下同时恢复默认信号处理
+pid_t spawnProcess(const std::string& path, char* const argv[], char* const envp[], const std::vector<FdAction>& actions,
+	pid_t pgid = -1, SpawnBackend backend = currentSpawnBackend());
+
+// 等待各阶段的子进程结束，记录退出状态、结束时间和资源使用
+// 作业控制下某个阶段被挂起（Ctrl-Z）时提前返回 false；不属于这些阶段的子进程交给作业表
+bool waitForStages(std::vector<StageUsage>& stages);
+
+// 输出 time 报告：整体的 real/user/sys/maxrss，管道时再列出每个阶段
+// self 为 shell 进程自身在此期间的资源增量（内置命令在 shell 内执行）
+void printTimeReport(double wallSeconds, const std::vector<StageUsage>& stages, const struct rusage& self);
+
+// launchExternal 的返回值：重定向失败（如 < nofile、<&7），命令没有启动，退出状态为 1 而不是 127
+constexpr pid_t LAUNCH_REDIRECT_FAILED = -2;
+// launchExternal 的返回值：文件存在但无法执行（如 hash -p 指定了没有执行权限的文件），退出状态为 126
+constexpr pid_t LAUNCH_NOT_EXECUTABLE = -3;
+
+// 启动外部命令（不等待）：actions（如管道）之后应用命令自身的重定向，构建 argv 并 spawn
+// 失败时输出错误，重定向失败返回 LAUNCH_REDIRECT_FAILED，无法执行返回 LAUNCH_NOT_EXECUTABLE，其它启动失败返回 -1。
+// execPath 由调用者查找（命令哈希表不是线程安全的）
+pid_t launchExternal(const std::string& execPath, const CommandInfo& cmdInfo, std::vector<FdAction> actions, pid_t pgid);
+
+// 查找外部命令：命令前有 PATH=... 赋值时按该 PATH 查找（最后一个生效），结果不放入哈希表
+std::string findCommandPath(const CommandInfo& cmdInfo);
+
+// 执行外部命令，stage 非空时返回执行结果；找不到或无法启动时返回 false
+// 重定向失败时返回 true，stage 为已结束、退出状态 1
+bool executeExternal(const CommandInfo& cmdInfo, StageUsage* stage = nullptr);
+
+// 执行管道命令，返回退出状态（最后一段的状态），stages 非空时返回各阶段的执行结果
+// 复合命令和修改 shell 状态的内置命令在子 shell 中执行，parsed 提供复合命令的内容
+// background 时不等待，作为后台作业加入作业表（内置命令也在子 shell 中执行）
+int executePipeline(const ParsedLine& parsed, const std::vector<CommandInfo>& pipeCommands,
+	std::vector<StageUsage>* stages = nullptr, bool background = false);
+
+// 执行命令列表（; & && || 以及 { } ( ) 组成的树），遇到 exit 返回 false；退出状态记录在 shellExitStatus
+bool executeList(const ParsedLine& parsed, const CommandList& list);
+
+// 读取命令行之后的一行（here-document 的正文），没有更多输入时返回 false
+using LineReader = std::function<bool(std::string&)>;
+
+// 依次读取各 here-document 的正文：后续各行直到定界符所在的行
+void readHereDocuments(ParsedLine& parsed, const LineReader& readLine);
+
+// 执行一行命令，遇到 exit 返回 false；readLine 提供 here-document 的正文（为空时正文为空）
+bool executeCommandLine(const std::string& command, const LineReader& readLine = nullptr);
@@ -0,0 +1,563 @@
+#include "glob.hpp"
+#include "options.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <condition_variable>
+#include <cstddef>       // offsetof
+#include <cstring>
+#include <dirent.h>      // DT_DIR 等
+#include <fcntl.h>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <sys/stat.h>
+#include <sys/syscall.h> // SYS_getdents64
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+
+//=============================================================================
+// 模式编译与匹配
+//=============================================================================
+
+bool isGlobChar(char c)
+{
+	return c == '*' || c == '?' || c == '[';
+}
+
+// 模式中是否有未转义的通配符 * ? [
+bool hasGlobChars(std::string_view pattern)
+{
+	for (size_t i = 0; i < pattern.size(); ++i)
+	{
+		if (pattern[i] == '\\')
+			i++;
+		else if (isGlobChar(pattern[i]))
+			return true;
+	}
+	return false;
+}
+
+// 把普通文本追加到模式中：通配符和反斜杠前加 \，按字面匹配
+void appendGlobLiteral(std::string& pattern, std::string_view text)
+{
+	for (char c : text)
+	{
+		if (isGlobChar(c) || c == '\\') pattern += '\\';
+		pattern += c;
+	}
+}
+
+// [:name:] 字符类（只含 ASCII 字符）
+bool addNamedClass(std::string_view name, std::bitset<256>& set)
+{
+	static const struct
+	{
+		const char* name;
+		int (*test)(int);
+	} NAMED_CLASSES[] = {
+		{ "alnum", isalnum }, { "alpha", isalpha }, { "blank", isblank }, { "cntrl", iscntrl },
+		{ "digit", isdigit }, { "graph", isgraph }, { "lower", islower }, { "print", isprint },
+		{ "punct", ispunct }, { "space", isspace }, { "upper", isupper }, { "xdigit", isxdigit },
+	};
+	for (const auto& named : NAMED_CLASSES)
+	{
+		if (name != named.name) continue;
+		for (int c = 0; c < 128; ++c)
+		{
+			if (named.test(c)) set.set(c);
+		}
+		return true;
+	}
+	return false;
+}
+
+// 解析 pattern[start] 开始的 [...]，返回 ] 的位置；没有闭合时返回 npos（[ 按字面匹配）
+// 支持 [!...] / [^...] 取反、a-z 范围、[:alpha:] 等字符类和 \ 转义
+size_t parseCharClass(std::string_view pattern, size_t start, std::bitset<256>& set)
+{
+	size_t i = start + 1;
+	bool negate = i < pattern.size() && (pattern[i] == '!' || pattern[i] == '^');
+	if (negate) i++;
+
+	bool first = true; // 紧跟在 [ 之后的 ] 是普通字符
+	while (i < pattern.size())
+	{
+		char c = pattern[i];
+		if (c == ']' && !first)
+		{
+			if (negate) set.flip();
+			return i;
+		}
+		first = false;
+
+		if (c == '[' && i + 1 < pattern.size() && pattern[i + 1] == ':')
+		{
+			size_t close = pattern.find(":]", i + 2);
+			if (close != std::string_view::npos && addNamedClass(pattern.substr(i + 2, close - i - 2), set))
+			{
+				i = close + 2;
+				continue;
+			}
+		}
+
+		if (c == '\\' && i + 1 < pattern.size()) i++;
+		unsigned char low = pattern[i++];
+		if (i + 1 < pattern.size() && pattern[i] == '-' && pattern[i + 1] != ']')
+		{
+			size_t highPos = i + 1;
+			if (pattern[highPos] == '\\' && highPos + 1 < pattern.size()) highPos++;
+			unsigned char high = pattern[highPos];
+			for (unsigned value = low; value <= high; ++value)
+			{
+				set.set(value);
+			}
+			i = highPos + 1;
+		}
+		else
+		{
+			set.set(low);
+		}
+	}
+	return std::string_view::npos;
+}
+
+// 编译单个路径分量的模式：相邻的普通字符合并为一段 Literal，连续的 * 合并为一个
+void compileGlob(std::string_view component, GlobMatcher& matcher)
+{
+	using Op = GlobMatcher::Op;
+	matcher = GlobMatcher();
+
+	auto addLiteral = [&](char c) {
+		if (matcher.steps.empty() || matcher.steps.back().op != Op::Literal)
+		{
+			matcher.steps.push_back({ Op::Literal, static_cast<uint32_t>(matcher.literals.size()), 0 });
+		}
+		matcher.literals += c;
+		matcher.steps.back().length++;
+	};
+
+	for (size_t i = 0; i < component.size(); ++i)
+	{
+		char c = component[i];
+		if (c == '\\' && i + 1 < component.size())
+		{
+			addLiteral(component[++i]);
+		}
+		else if (c == '*')
+		{
+			if (matcher.steps.empty() || matcher.steps.back().op != Op::AnyString) matcher.steps.push_back({ Op::AnyString, 0, 0 });
+		}
+		else if (c == '?')
+		{
+			matcher.steps.push_back({ Op::AnyChar, 0, 0 });
+		}
+		else if (c == '[')
+		{
+			std::bitset<256> set;
+			size_t end = parseCharClass(component, i, set);
+			if (end == std::string_view::npos)
+			{
+				addLiteral(c);
+				continue;
+			}
+			matcher.steps.push_back({ Op::CharClass, static_cast<uint32_t>(matcher.classes.size()), 0 });
+			matcher.classes.push_back(set);
+			i = end;
+		}
+		else
+		{
+			addLiteral(c);
+		}
+	}
+
+	const auto& steps = matcher.steps;
+	matcher.literal = steps.empty() || (steps.size() == 1 && steps[0].op == Op::Literal);
+	if (!steps.empty() && steps[0].op == Op::Literal)
+	{
+		matcher.prefix = matcher.literals.substr(steps[0].index, steps[0].length);
+		matcher.leadingDot = matcher.prefix.starts_with('.');
+	}
+	if (steps.size() >= 2 && steps.back().op == Op::Literal && steps[steps.size() - 2].op == Op::AnyString)
+	{
+		matcher.suffix = matcher.literals.substr(steps.back().index, steps.back().length);
+	}
+}
+
+// name[pos] 开始的 UTF-8 字符的字节数（无效的字节按一个字符计）
+size_t utf8Length(std::string_view name, size_t pos)
+{
+	unsigned char lead = name[pos];
+	size_t length = lead < 0xC0 ? 1 : lead < 0xE0 ? 2 : lead < 0xF0 ? 3 : lead < 0xF8 ? 4 : 1;
+	return std::min(length, name.size() - pos);
+}
+
+// 文件名是否匹配：逐步匹配，失败时回到最近的 * 多吞一个字符再试
+// 先用固定前缀/后缀排除，*.log 这类模式对不匹配的文件名只需比较一次后缀
+bool globMatch(const GlobMatcher& matcher, std::string_view name)
+{
+	using Op = GlobMatcher::Op;
+	if (!name.starts_with(matcher.prefix) || !name.ends_with(matcher.suffix)) return false;
+	if (matcher.literal) return name == matcher.literals;
+
+	const auto& steps = matcher.steps;
+	std::string_view literals = matcher.literals;
+	size_t s = 0;
+	size_t n = 0;
+	size_t starStep = std::string_view::npos;
+	size_t starName = 0;
+
+	while (s < steps.size() || n < name.size())
+	{
+		if (s < steps.size())
+		{
+			const GlobMatcher::Step& step = steps[s];
+			switch (step.op)
+			{
+			case Op::AnyString:
+				starStep = s++;
+				starName = n;
+				if (s == steps.size()) return true; // 末尾的 * 匹配剩下的全部
+				continue;
+			case Op::AnyChar:
+				if (n < name.size())
+				{
+					n += utf8Length(name, n);
+					s++;
+					continue;
+				}
+				break;
+			case Op::CharClass:
+				if (n < name.size() && matcher.classes[step.index].test(static_cast<unsigned char>(name[n])))
+				{
+					n++;
+					s++;
+					continue;
+				}
+				break;
+			case Op::Literal:
+				if (name.substr(n, step.length) == literals.substr(step.index, step.length))
+				{
+					n += step.length;
+					s++;
+					continue;
+				}
+				break;
+			}
+		}
+
+		// 不匹配：回到最近的 *
+		if (starStep == std::string_view::npos || starName >= name.size()) return false;
+		starName++;
+		s = starStep + 1;
+		n = starName;
+	}
+	return true;
+}
+
+//=============================================================================
+// 目录读取与缓存
+//=============================================================================
+
+// 目录列表缓存：键为目录路径（以 / 结尾，当前目录为空串），命令行执行期间有效
+std::mutex globCacheMutex;
+std::unordered_map<std::string, std::shared_ptr<const DirectoryListing>> globCache;
+
+// getdents64 返回的记录头（内核 ABI：文件名紧跟在 d_type 之后）
+struct Dirent64Header
+{
+	uint64_t ino;
+	int64_t off;
+	unsigned short reclen;
+	unsigned char type;
+};
+constexpr size_t DIRENT_NAME_OFFSET = offsetof(Dirent64Header, type) + 1;
+
+bool sameDirectory(const DirectoryListing& listing, const struct stat& st)
+{
+	return listing.dev == st.st_dev && listing.ino == st.st_ino && listing.mtime.tv_sec == st.st_mtim.tv_sec
+		&& listing.mtime.tv_nsec == st.st_mtim.tv_nsec;
+}
+
+// 读取目录 fd 的下一批条目：一次 getdents64 系统调用，对每个条目（跳过 . 和 ..）调用 onEntry(name, d_type)
+// 已读完或出错时返回 false
+bool readDirectoryBatch(int fd, char* buffer, size_t size, const std::function<void(std::string_view, unsigned char)>& onEntry)
+{
+	ssize_t n;
+	while ((n = syscall(SYS_getdents64, fd, buffer, size)) == -1 && errno == EINTR) {}
+	if (n <= 0) return false;
+
+	for (ssize_t pos = 0; pos < n;)
+	{
+		Dirent64Header header;
+		std::memcpy(&header, buffer + pos, sizeof(header));
+		const char* name = buffer + pos + DIRENT_NAME_OFFSET;
+		pos += header.reclen;
+		if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) continue;
+		onEntry(name, header.type);
+	}
+	return true;
+}
+
+// 读取目录（path 为空表示当前目录），命令行执行期间缓存；无法读取时返回 nullptr
+// 直接调用 getdents64，一次系统调用取回数千个条目，并得到 d_type，多数条目不需要再 stat
+std::shared_ptr<const DirectoryListing> readDirectoryListing(const std::string& path)
+{
+	const char* dirPath = path.empty() ? "." : path.c_str();
+	struct stat st;
+	if (stat(dirPath, &st) == -1 || !S_ISDIR(st.st_mode)) return nullptr;
+	{
+		std::lock_guard<std::mutex> lock(globCacheMutex);
+		auto cached = globCache.find(path);
+		if (cached != globCache.end() && sameDirectory(*cached->second, st)) return cached->second;
+	}
+
+	int fd = open(dirPath, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd == -1) return nullptr;
+	auto listing = std::make_shared<DirectoryListing>();
+	if (fstat(fd, &st) == 0)
+	{
+		listing->dev = st.st_dev;
+		listing->ino = st.st_ino;
+		listing->mtime = st.st_mtim;
+	}
+
+	constexpr size_t BUFFER_SIZE = 256 * 1024;
+	thread_local std::unique_ptr<char[]> buffer = std::make_unique<char[]>(BUFFER_SIZE);
+	auto addEntry = [&listing](std::string_view name, unsigned char type) {
+		listing->offsets.push_back(static_cast<uint32_t>(listing->names.size()));
+		listing->names.append(name);
+		listing->names += '\0';
+		listing->types.push_back(type);
+	};
+	while (readDirectoryBatch(fd, buffer.get(), BUFFER_SIZE, addEntry)) {}
+	close(fd);
+
+	std::lock_guard<std::mutex> lock(globCacheMutex);
+	globCache[path] = listing;
+	return listing;
+}
+
+// 清空目录列表缓存（每行命令开始执行时调用）
+void clearGlobCache()
+{
+	std::lock_guard<std::mutex> lock(globCacheMutex);
+	globCache.clear();
+}
+
+// 目录条目是否是目录：d_type 已知时不需要 stat；followLinks 时指向目录的符号链接也算
+bool isDirectoryEntry(unsigned char type, const std::string& path, bool followLinks)
+{
+	if (type == DT_DIR) return true;
+	if (type != DT_UNKNOWN && !(followLinks && type == DT_LNK)) return false;
+	struct stat st;
+	int result = followLinks ? stat(path.c_str(), &st) : lstat(path.c_str(), &st);
+	return result == 0 && S_ISDIR(st.st_mode);
+}
+
+// 以 . 开头的文件名只被以字面 . 开头的模式匹配（dotglob 除外）
+bool isVisible(std::string_view name, bool leadingDot)
+{
+	return name[0] != '.' || leadingDot || optDotglob;
+}
+
+//=============================================================================
+// ** 的并行遍历
+//=============================================================================
+
+// 遍历状态：待读取的目录由多个线程共享
+struct TreeWalk
+{
+	std::mutex mutex;
+	std::condition_variable wakeup;
+	std::vector<std::string> pending; // 待读取的目录（以 / 结尾）
+	size_t active{};                  // 正在读取目录的线程数
+	bool includeEntries{};            // ** 是最后一个分量：结果为所有条目，否则为所有目录
+	bool onlyDirs{};                  // 模式以 / 结尾：只要目录
+	std::vector<std::string> results;
+};
+
+// 读取一个目录：子目录追加到 subdirs，作为结果的条目追加到 found
+void walkDirectory(const TreeWalk& walk, const std::string& dir, std::vector<std::string>& subdirs,
+	std::vector<std::string>& found)
+{
+	if (!walk.includeEntries) found.push_back(dir);
+	auto listing = readDirectoryListing(dir);
+	if (!listing) return;
+
+	for (size_t i = 0; i < listing->size(); ++i)
+	{
+		std::string_view name = listing->name(i);
+		if (!isVisible(name, false)) continue;
+		std::string path = dir;
+		path += name;
+		// 不跟随符号链接，避免目录环
+		bool isDir = isDirectoryEntry(listing->types[i], path, false);
+		if (isDir) subdirs.push_back(path + '/');
+		if (walk.includeEntries && (isDir || !walk.onlyDirs)) found.push_back(isDir && walk.onlyDirs ? path + '/' : std::move(path));
+	}
+}
+
+// 工作线程：不断取出待读取的目录，直到没有目录且没有线程还在读取（不会再产生新目录）
+void runTreeWalker(TreeWalk& walk)
+{
+	std::vector<std::string> subdirs;
+	std::vector<std::string> found;
+	std::unique_lock<std::mutex> lock(walk.mutex);
+	while (true)
+	{
+		walk.wakeup.wait(lock, [&walk]() { return !walk.pending.empty() || walk.active == 0; });
+		if (walk.pending.empty()) return;
+
+		std::string dir = std::move(walk.pending.back());
+		walk.pending.pop_back();
+		walk.active++;
+		lock.unlock();
+
+		subdirs.clear();
+		found.clear();
+		walkDirectory(walk, dir, subdirs, found);
+
+		lock.lock();
+		walk.active--;
+		std::move(found.begin(), found.end(), std::back_inserter(walk.results));
+		std::move(subdirs.begin(), subdirs.end(), std::back_inserter(walk.pending));
+		walk.wakeup.notify_all();
+	}
+}
+
+// 展开 **：base 及其下所有子目录（非末尾分量），或 base 本身和之下的所有条目（末尾分量）
+// 前几十个目录在当前线程中读取，目录树较大时再启动工作线程并行读取
+void walkTree(const std::string& base, bool last, bool onlyDirs, std::vector<std::string>& out)
+{
+	if (last && !base.empty()) out.push_back(base);
+
+	TreeWalk walk;
+	walk.includeEntries = last;
+	walk.onlyDirs = onlyDirs;
+	walk.pending.push_back(base);
+
+	constexpr size_t SERIAL_DIRS = 32;
+	constexpr size_t MAX_WORKERS = 8;
+	for (size_t n = 0; n < SERIAL_DIRS && !walk.pending.empty(); ++n)
+	{
+		std::string dir = std::move(walk.pending.back());
+		walk.pending.pop_back();
+		walkDirectory(walk, dir, walk.pending, walk.results);
+	}
+
+	if (!walk.pending.empty())
+	{
+		size_t numWorkers = std::min<size_t>(MAX_WORKERS, std::max(1u, std::thread::hardware_concurrency()));
+		std::vector<std::thread> workers;
+		for (size_t i = 1; i < numWorkers; ++i)
+		{
+			workers.emplace_back(runTreeWalker, std::ref(walk));
+		}
+		runTreeWalker(walk); // 当前线程也参与遍历
+		for (auto& t : workers)
+		{
+			t.join();
+		}
+	}
+
+	std::move(walk.results.begin(), walk.results.end(), std::back_inserter(out));
+}
+
+//=============================================================================
+// 路径名展开
+//=============================================================================
+
+// 在目录 base 中匹配一个分量，非末尾分量只保留目录（追加 /）
+// 先按文件名排序再拼接路径：同一目录的结果有序，比较时不必经过相同的目录前缀
+void matchDirectory(const std::string& base, const GlobMatcher& matcher, bool needDir, std::vector<std::string>& out)
+{
+	auto listing = readDirectoryListing(base);
+	if (!listing) return;
+
+	std::vector<uint32_t> matched;
+	for (size_t i = 0; i < listing->size(); ++i)
+	{
+		std::string_view name = listing->name(i);
+		if (isVisible(name, matcher.leadingDot) && globMatch(matcher, name)) matched.push_back(static_cast<uint32_t>(i));
+	}
+	std::sort(matched.begin(), matched.end(), [&listing](uint32_t a, uint32_t b) { return listing->name(a) < listing->name(b); });
+
+	for (uint32_t i : matched)
+	{
+		std::string_view name = listing->name(i);
+		std::string path;
+		path.reserve(base.size() + name.size() + 1);
+		path += base;
+		path += name;
+		if (needDir)
+		{
+			if (!isDirectoryEntry(listing->types[i], path, true)) continue;
+			path += '/';
+		}
+		out.push_back(std::move(path));
+	}
+}
+
+// 展开 pattern，匹配的路径按字节序排序后追加到 matches；没有匹配返回 false
+// 逐个分量处理：当前得到的每个目录中匹配下一个分量。不含通配符的分量直接拼接，不读目录
+bool expandGlob(std::string_view pattern, std::vector<std::string>& matches)
+{
+	std::vector<std::string_view> components;
+	size_t pos = 0;
+	while (pos < pattern.size())
+	{
+		size_t slash = pattern.find('/', pos);
+		if (slash == std::string_view::npos) slash = pattern.size();
+		if (slash > pos) components.push_back(pattern.substr(pos, slash - pos));
+		pos = slash + 1;
+	}
+	if (components.empty()) return false;
+	bool trailingSlash = pattern.ends_with('/');
+
+	// 已匹配的目录前缀，都以 / 结尾（当前目录为空串）
+	std::vector<std::string> paths{ pattern.starts_with('/') ? "/" : "" };
+	std::vector<std::string> next;
+	GlobMatcher matcher;
+	for (size_t c = 0; c < components.size() && !paths.empty(); ++c)
+	{
+		bool last = c + 1 == components.size();
+		bool needDir = !last || trailingSlash;
+		next.clear();
+
+		if (components[c] == "**" && optGlobstar)
+		{
+			for (const auto& base : paths)
+			{
+				walkTree(base, last, trailingSlash, next);
+			}
+		}
+		else
+		{
+			compileGlob(components[c], matcher);
+			for (const auto& base : paths)
+			{
+				if (!matcher.literal)
+				{
+					matchDirectory(base, matcher, needDir, next);
+					continue;
+				}
+				// 普通分量：中间的目录不检查（读取下一层时自然失败），最后一个分量必须存在
+				std::string path = base + matcher.literals;
+				struct stat st;
+				if (last && (needDir ? stat(path.c_str(), &st) == -1 || !S_ISDIR(st.st_mode) : lstat(path.c_str(), &st) == -1)) continue;
+				if (needDir) path += '/';
+				next.push_back(std::move(path));
+			}
+		}
+		std::swap(paths, next);
+	}
+	if (paths.empty()) return false;
+
+	// 没有 ** 时各目录依次匹配，结果通常已经有序
+	if (!std::is_sorted(paths.begin(), paths.end())) std::sort(paths.begin(), paths.end());
+	std::move(paths.begin(), paths.end(), std::back_inserter(matches));
+	return true;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <bitset>
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <sys/types.h>
+#include <vector>
+
+//=============================================================================
+// 路径名展开 * ? [...] **
+//=============================================================================
+
+// 编译后的单个路径分量（两个 / 之间）的模式
+struct GlobMatcher
+{
+	enum class Op : uint8_t
+	{
+		Literal,   // literals 中 [index, index + length) 的固定文本
+		AnyChar,   // ?：一个字符（UTF-8 多字节字符算一个）
+		AnyString, // *：任意长度
+		CharClass  // [...]：classes[index]
+	};
+	struct Step
+	{
+		Op op;
+		uint32_t index;
+		uint32_t length;
+	};
+
+	std::vector<Step> steps;
+	std::string literals;
+	std::vector<std::bitset<256>> classes;
+	std::string prefix;       // 第一个通配符之前的固定文本，快速排除
+	std::string suffix;       // 最后一个 * 之后的固定文本，快速排除
+	bool literal{};           // 没有通配符：literals 就是文件名本身
+	bool leadingDot{};        // 以字面的 . 开头：可以匹配隐藏文件
+};
+
+// 单个目录的全部条目：文件名连续存放在一块内存中，百万个条目也只有几次分配
+// 通过目录的 dev/ino/mtime 判断缓存是否仍然有效（与 PATH 补全索引相同）
+struct DirectoryListing
+{
+	std::string names;              // 各文件名依次存放，以 '\0' 分隔
+	std::vector<uint32_t> offsets;  // 每个文件名在 names 中的起点
+	std::vector<unsigned char> types; // getdents64 返回的 d_type（DT_UNKNOWN 时需要 stat）
+	dev_t dev{};
+	ino_t ino{};
+	struct timespec mtime{};
+
+	size_t size() const { return offsets.size(); }
+	std::string_view name(size_t i) const
+	{
+		size_t end = i + 1 < offsets.size() ? offsets[i + 1] : names.size();
+		return { names.data() + offsets[i], end - offsets[i] - 1 };
+	}
+};
+
+// 模式中是否有未转义的通配符 * ? [
+bool hasGlobChars(std::string_view pattern);
+
+// 把普通文本追加到模式中：通配符和反斜杠前加 \，按字面匹配
+void appendGlobLiteral(std::string& pattern, std::string_view text);
+
+// 编译单个路径分量的模式
+void compileGlob(std::string_view component, GlobMatcher& matcher);
+
+// 文件名是否匹配（不处理隐藏文件规则）
+bool globMatch(const GlobMatcher& matcher, std::string_view name);
+
+// 读取目录 fd 的下一批条目：一次 getdents64 系统调用，对每个条目（跳过 . 和 ..）调用 onEntry(name, d_type)
+// 已读完或出错时返回 false。逐批读取的调用者可以在批次之间放弃（如补全被取消）
+bool readDirectoryBatch(int fd, char* buffer, size_t size, const std::function<void(std::string_view, unsigned char)>& onEntry);
+
+// 读取目录（path 为空表示当前目录），命令行执行期间缓存；无法读取时返回 nullptr
+std::shared_ptr<const DirectoryListing> readDirectoryListing(const std::string& path);
+
+// 展开 pattern，匹配的路径按字节序排序后追加到 matches；没有匹配返回 false
+// shopt dotglob：* ? [ 也匹配以 . 开头的文件名；globstar：单独的 ** 匹配任意层子目录（并行遍历）
+bool expandGlob(std::string_view pattern, std::vector<std::string>& matches);
+
+// 清空目录列表缓存（每行命令开始执行时调用）
+void clearGlobCache();
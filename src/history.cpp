@@ -0,0 +1,531 @@
+#include "history.hpp"
+#include "variables.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>      // snprintf()
+#include <cstring>     // memrchr()
+#include <fcntl.h>     // open()
+#include <functional>  // std::hash
+#include <iostream>
+#include <sys/file.h>  // flock()
+#include <sys/stat.h>  // fstat()
+#include <unistd.h>    // write(), close()
+
+// 命令历史记录
+HistoryStore commandHistory;
+// 记录上次 history -a 追加到文件的位置（本次会话新增命令中的下标）
+size_t lastAppendedIndex = 0;
+
+// 读入文件作为历史记录的开头，失败或文件为空返回 false
+// 一次按文件大小分配、读到 EOF 为止（读取期间文件被截断或追加也只是得到当时的内容），不逐行拆分
+bool HistoryStore::loadFile(const std::string& filePath)
+{
+	int fd = open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd == -1) return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	// 多留一个字节：读到 EOF 时不必扩容就能确认已读完
+	std::string data(st.st_size + 1, '\0');
+	size_t got = 0;
+	while (true)
+	{
+		if (got == data.size()) data.resize(data.size() * 2); // 读取期间文件变长
+		ssize_t n = read(fd, data.data() + got, data.size() - got);
+		if (n == -1 && errno == EINTR) continue;
+		if (n <= 0) break;
+		got += n;
+	}
+	close(fd);
+	data.resize(got);
+	if (data.empty()) return false;
+
+	clear();
+	fileData = std::move(data);
+	fileLoaded = true;
+	fileDev = st.st_dev;
+	fileIno = st.st_ino;
+	unindexedEnd = fileData.size();
+	return true;
+}
+
+// 从文件末尾向前建立索引，直到至少有 count 行或到达文件开头
+void HistoryStore::indexTail(size_t count)
+{
+	while (fileLines.size() < count && unindexedEnd > 0)
+	{
+		// 跳过行尾换行符：最后一行可能没有换行
+		const char* data = fileData.data();
+		size_t end = unindexedEnd;
+		if (data[end - 1] == '\n') end--;
+
+		const void* newline = end > 0 ? memrchr(data, '\n', end) : nullptr;
+		size_t start = newline ? static_cast<const char*>(newline) - data + 1 : 0;
+		unindexedEnd = start;
+
+		// 与逐行读取时一样忽略空行
+		if (end > start) fileLines.push_back({ start, end - start });
+	}
+}
+
+// 文件部分第 i 行（正序）
+std::string_view HistoryStore::fileLine(size_t i) const
+{
+	const LineSpan& span = fileLines[fileLines.size() - 1 - i];
+	return std::string_view(fileData.data() + span.offset, span.length);
+}
+
+// 总条数（需要为整个文件建立索引，只在 history 列表等场合调用）
+size_t HistoryStore::size()
+{
+	indexTail(SIZE_MAX);
+	return fileLines.size() + sessionLines.size();
+}
+
+bool HistoryStore::empty()
+{
+	if (!sessionLines.empty()) return false;
+	indexTail(1);
+	return fileLines.empty();
+}
+
+// 第 i 条（从 0 开始，最旧的在前）
+std::string HistoryStore::operator[](size_t i)
+{
+	indexTail(SIZE_MAX);
+	return std::string(view(i));
+}
+
+// 第 i 条的视图，不复制（指向文件内容或会话记录，push_back/clear 后失效）
+std::string_view HistoryStore::view(size_t i)
+{
+	indexTail(SIZE_MAX);
+	if (i < fileLines.size()) return fileLine(i);
+	return sessionView(i - fileLines.size());
+}
+
+// 倒数第 k+1 条（k = 0 为最新），不存在返回 false；只为需要的部分建立索引
+bool HistoryStore::recent(size_t k, std::string& entry)
+{
+	if (k < sessionLines.size())
+	{
+		entry = sessionView(sessionLines.size() - 1 - k);
+		return true;
+	}
+
+	size_t fileK = k - sessionLines.size();
+	indexTail(fileK + 1);
+	if (fileK >= fileLines.size()) return false;
+
+	const LineSpan& span = fileLines[fileK];
+	entry.assign(fileData, span.offset, span.length);
+	return true;
+}
+
+void HistoryStore::push_back(std::string_view entry)
+{
+	sessionLines.push_back(intern(entry));
+}
+
+std::string_view HistoryStore::text(uint32_t id) const
+{
+	const TextSpan& span = texts[id];
+	return std::string_view(textArena.data() + span.offset, span.length);
+}
+
+std::string_view HistoryStore::sessionView(size_t i) const
+{
+	return text(sessionLines[i]);
+}
+
+// 查找或加入文本，返回文本编号
+uint32_t HistoryStore::intern(std::string_view entry)
+{
+	// 负载超过 1/2 时扩容并重新插入
+	if ((texts.size() + 1) * 2 > textSlots.size())
+	{
+		std::vector<uint32_t> slots(std::max<size_t>(64, textSlots.size() * 2), 0);
+		size_t mask = slots.size() - 1;
+		for (uint32_t id = 0; id < texts.size(); ++id)
+		{
+			size_t slot = std::hash<std::string_view>{}(text(id)) & mask;
+			while (slots[slot] != 0) slot = (slot + 1) & mask;
+			slots[slot] = id + 1;
+		}
+		textSlots.swap(slots);
+	}
+
+	size_t mask = textSlots.size() - 1;
+	size_t slot = std::hash<std::string_view>{}(entry) & mask;
+	while (textSlots[slot] != 0)
+	{
+		uint32_t id = textSlots[slot] - 1;
+		if (text(id) == entry) return id;
+		slot = (slot + 1) & mask;
+	}
+
+	uint32_t id = static_cast<uint32_t>(texts.size());
+	texts.push_back({ static_cast<uint32_t>(textArena.size()), static_cast<uint32_t>(entry.length()) });
+	textArena.insert(textArena.end(), entry.begin(), entry.end());
+	textSlots[slot] = id + 1;
+	return id;
+}
+
+// 删除会话记录中与 entry 相同的条目，返回被删除条目中下标小于 limit 的个数
+size_t HistoryStore::eraseSession(std::string_view entry, size_t limit)
+{
+	size_t before = 0;
+	size_t kept = 0;
+	for (size_t i = 0; i < sessionLines.size(); ++i)
+	{
+		if (sessionView(i) == entry)
+		{
+			if (i < limit) before++;
+			continue;
+		}
+		sessionLines[kept++] = sessionLines[i];
+	}
+	if (kept != sessionLines.size())
+	{
+		sessionLines.resize(kept);
+		generation++;
+	}
+	return before;
+}
+
+void HistoryStore::clear()
+{
+	fileData.clear();
+	fileData.shrink_to_fit();
+	fileLoaded = false;
+	unindexedEnd = 0;
+	fileLines.clear();
+	textArena.clear();
+	texts.clear();
+	textSlots.clear();
+	sessionLines.clear();
+	generation++;
+	fileGeneration++;
+}
+
+// 完整写入 fd，处理部分写入和 EINTR
+bool writeAll(int fd, const std::string& data)
+{
+	size_t written = 0;
+	while (written < data.size())
+	{
+		ssize_t n = write(fd, data.data() + written, data.size() - written);
+		if (n == -1)
+		{
+			if (errno == EINTR) continue;
+			return false;
+		}
+		written += n;
+	}
+	return true;
+}
+
+// HISTCONTROL 是否包含某一项
+bool histControlHas(std::string_view control, std::string_view item)
+{
+	while (!control.empty())
+	{
+		size_t colon = control.find(':');
+		if (control.substr(0, colon) == item) return true;
+		if (colon == std::string_view::npos) break;
+		control.remove_prefix(colon + 1);
+	}
+	return false;
+}
+
+// 按 HISTCONTROL（ignorespace、ignoredups、ignoreboth、erasedups，冒号分隔）记录一条命令
+void addHistoryEntry(std::string_view line)
+{
+	const std::string* env = getVariable("HISTCONTROL");
+	std::string_view control = env ? std::string_view(*env) : "";
+	bool ignoreBoth = histControlHas(control, "ignoreboth");
+
+	if ((ignoreBoth || histControlHas(control, "ignorespace")) && line.starts_with(' ')) return;
+
+	if (ignoreBoth || histControlHas(control, "ignoredups"))
+	{
+		std::string last;
+		if (commandHistory.recent(0, last) && last == line) return;
+	}
+
+	if (histControlHas(control, "erasedups"))
+	{
+		// 只能删除会话中的旧条目，文件部分只按行偏移索引，不可修改
+		lastAppendedIndex -= commandHistory.eraseSession(line, lastAppendedIndex);
+	}
+
+	commandHistory.push_back(line);
+}
+
+// 从文件加载历史记录：历史为空时直接作为文件部分，否则读入并追加到会话记录
+void loadHistoryFromFile(const std::string& filePath)
+{
+	if (!commandHistory.fileLoaded && commandHistory.sessionLines.empty())
+	{
+		commandHistory.loadFile(filePath);
+		return;
+	}
+
+	// 已有历史（history -r）：借用一个临时存储逐行复制
+	HistoryStore loaded;
+	if (!loaded.loadFile(filePath)) return;
+	size_t count = loaded.size();
+	for (size_t i = 0; i < count; ++i)
+	{
+		commandHistory.push_back(loaded.fileLine(i));
+	}
+}
+
+// 打开并锁定历史文件。其它会话可能在我们等锁期间用 rename 替换了文件（history -w），
+// 拿到锁后确认 fd 仍是路径当前指向的文件，否则重新打开。flock 不可用时（如部分 NFS）不加锁继续
+int openLockedHistoryFile(const std::string& filePath, int flags, int lockType)
+{
+	while (true)
+	{
+		int fd = open(filePath.c_str(), flags | O_CLOEXEC, 0600);
+		if (fd == -1) return -1;
+
+		int err = 0;
+		while ((err = flock(fd, lockType)) == -1 && errno == EINTR) {}
+		if (err == -1) return fd;
+
+		struct stat fdStat, pathStat;
+		if (fstat(fd, &fdStat) == 0 && stat(filePath.c_str(), &pathStat) == 0 &&
+			fdStat.st_dev == pathStat.st_dev && fdStat.st_ino == pathStat.st_ino)
+		{
+			return fd;
+		}
+		close(fd);
+	}
+}
+
+// 文件最后一个字节不是换行时返回 true（追加前需要先补换行）
+bool missingTrailingNewline(int fd, off_t size)
+{
+	char last = '\n';
+	if (size > 0) pread(fd, &last, 1, size - 1);
+	return last != '\n';
+}
+
+// 将全部历史记录写入文件（写临时文件后 rename，其它会话不会读到写了一半的文件）
+void saveHistoryToFile(const std::string& filePath)
+{
+	std::string data;
+	commandHistory.indexTail(SIZE_MAX);
+	data.reserve(commandHistory.fileData.size() + commandHistory.textArena.size() + commandHistory.sessionCount());
+	for (size_t i = 0; i < commandHistory.fileLines.size(); ++i)
+	{
+		data += commandHistory.fileLine(i);
+		data += '\n';
+	}
+	for (size_t i = 0; i < commandHistory.sessionCount(); ++i)
+	{
+		data += commandHistory.sessionView(i);
+		data += '\n';
+	}
+
+	// 替换期间锁住旧文件，正在等锁的追加者拿到锁后会发现文件已被替换并重新打开
+	int lockFd = openLockedHistoryFile(filePath, O_RDWR | O_CREAT, LOCK_EX);
+
+	std::string tmpPath = filePath + ".tmp";
+	int fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+	if (fd != -1)
+	{
+		bool ok = writeAll(fd, data);
+		close(fd);
+		if (!ok || rename(tmpPath.c_str(), filePath.c_str()) != 0)
+		{
+			unlink(tmpPath.c_str());
+		}
+	}
+	if (lockFd != -1) close(lockFd);
+}
+
+// 将本次会话从 sessionStart 开始的命令以一次 O_APPEND write 追加到文件
+void appendHistoryToFile(const std::string& filePath, size_t sessionStart)
+{
+	size_t count = commandHistory.sessionCount();
+	if (sessionStart >= count) return;
+
+	int fd = openLockedHistoryFile(filePath, O_RDWR | O_CREAT | O_APPEND, LOCK_EX);
+	if (fd == -1) return;
+
+	// 文件最后一行没有换行时先补上，避免与新命令连成一行
+	std::string data;
+	struct stat st;
+	if (fstat(fd, &st) == 0 && missingTrailingNewline(fd, st.st_size)) data += '\n';
+
+	for (size_t i = sessionStart; i < count; ++i)
+	{
+		data += commandHistory.sessionView(i);
+		data += '\n';
+	}
+	writeAll(fd, data);
+	close(fd);
+}
+
+//=============================================================================
+// 多个会话共享 HISTFILE
+//=============================================================================
+
+// 本会话对共享 HISTFILE 的读取进度
+struct SharedHistoryState
+{
+	bool started{};
+	dev_t dev{};
+	ino_t ino{};
+	off_t readOffset{}; // 此前的内容已读入内存
+	char lastByte{};    // readOffset 前一个字节，用于发现文件被原地改写
+};
+
+SharedHistoryState sharedHistory;
+
+// 共享历史：在一次排他锁内读入其它会话追加的新行，并追加本会话尚未写入的命令
+void syncSharedHistory(const std::string& filePath)
+{
+	int fd = openLockedHistoryFile(filePath, O_RDWR | O_CREAT | O_APPEND, LOCK_EX);
+	if (fd == -1) return;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0)
+	{
+		close(fd);
+		return;
+	}
+
+	bool sameFile = st.st_dev == sharedHistory.dev && st.st_ino == sharedHistory.ino;
+	if (!sharedHistory.started)
+	{
+		// 第一次同步：启动时读入的正是这个文件时从读入的末尾继续读，否则（文件不存在或为空）从头读
+		bool loaded = commandHistory.fileLoaded;
+		sameFile = !loaded || (st.st_dev == commandHistory.fileDev && st.st_ino == commandHistory.fileIno);
+		sharedHistory.readOffset = loaded ? commandHistory.fileData.size() : 0;
+		sharedHistory.lastByte = loaded ? commandHistory.fileData.back() : '\n';
+		sharedHistory.started = true;
+	}
+
+	// 文件比已读入的部分短（被截断），或读入部分的末尾字节变了（截断后又被追加、原地改写）：
+	// 内存中的副本不受影响，但 readOffset 之后已不是新追加的行
+	bool rewritten = !sameFile || st.st_size < sharedHistory.readOffset;
+	if (!rewritten && sharedHistory.readOffset > 0)
+	{
+		char last = 0;
+		rewritten = pread(fd, &last, 1, sharedHistory.readOffset - 1) != 1 || last != sharedHistory.lastByte;
+	}
+	if (rewritten)
+	{
+		// 无法区分哪些行是新的，从当前末尾开始跟踪
+		sharedHistory.readOffset = st.st_size;
+		sharedHistory.lastByte = 0;
+		if (st.st_size > 0 && pread(fd, &sharedHistory.lastByte, 1, st.st_size - 1) != 1) sharedHistory.lastByte = 0;
+	}
+	sharedHistory.dev = st.st_dev;
+	sharedHistory.ino = st.st_ino;
+
+	// 增量读取其它会话追加的部分
+	std::string tail(st.st_size - sharedHistory.readOffset, '\0');
+	size_t got = 0;
+	while (got < tail.size())
+	{
+		ssize_t n = pread(fd, tail.data() + got, tail.size() - got, sharedHistory.readOffset + got);
+		if (n == -1 && errno == EINTR) continue;
+		if (n <= 0) break;
+		got += n;
+	}
+	tail.resize(got);
+
+	size_t pendingStart = std::min(lastAppendedIndex, commandHistory.sessionCount());
+	bool hasPending = pendingStart < commandHistory.sessionCount();
+
+	// 只接受完整的行；要追加时末尾的不完整行会被补上换行，一并接受
+	size_t lastNewline = tail.rfind('\n');
+	size_t consumed = hasPending ? tail.size() : lastNewline == std::string::npos ? 0 : lastNewline + 1;
+	std::string_view newData(tail.data(), consumed);
+	std::vector<uint32_t> imported;
+	while (!newData.empty())
+	{
+		size_t newline = newData.find('\n');
+		std::string_view line = newData.substr(0, newline);
+		if (!line.empty()) imported.push_back(commandHistory.intern(line));
+		if (newline == std::string_view::npos) break;
+		newData.remove_prefix(newline + 1);
+	}
+	sharedHistory.readOffset += consumed;
+	if (consumed > 0) sharedHistory.lastByte = tail[consumed - 1];
+
+	// 其它会话的命令排在本会话尚未写入的命令之前，与文件中的顺序一致
+	if (!imported.empty())
+	{
+		auto& lines = commandHistory.sessionLines;
+		lines.insert(lines.begin() + pendingStart, imported.begin(), imported.end());
+		if (hasPending) commandHistory.generation++;
+		pendingStart += imported.size();
+	}
+
+	if (hasPending)
+	{
+		std::string data;
+		if (missingTrailingNewline(fd, st.st_size)) data += '\n';
+		for (size_t i = pendingStart; i < commandHistory.sessionCount(); ++i)
+		{
+			data += commandHistory.sessionView(i);
+			data += '\n';
+		}
+		// 持有排他锁，这次写入紧接在刚读到的末尾之后
+		if (writeAll(fd, data))
+		{
+			sharedHistory.readOffset = st.st_size + data.size();
+			sharedHistory.lastByte = '\n';
+		}
+	}
+	lastAppendedIndex = commandHistory.sessionCount();
+	close(fd);
+}
+
+// history --stats：各部分占用的内存，以及每条命令一个 std::string 时的估算
+void printHistoryStats()
+{
+	const HistoryStore& h = commandHistory;
+	commandHistory.indexTail(SIZE_MAX);
+
+	// 对照：每条会话命令一个 std::string（超出 SSO 容量的另有一次堆分配）
+	size_t stringBytes = 0;
+	for (size_t i = 0; i < h.sessionCount(); ++i)
+	{
+		size_t length = h.sessionView(i).length();
+		stringBytes += sizeof(std::string) + (length > 15 ? length + 1 : 0);
+	}
+
+	size_t arenaBytes = h.textArena.capacity() + h.texts.capacity() * sizeof(HistoryStore::TextSpan);
+	size_t tableBytes = h.textSlots.capacity() * sizeof(uint32_t);
+	size_t idBytes = h.sessionLines.capacity() * sizeof(uint32_t);
+	size_t sessionBytes = arenaBytes + tableBytes + idBytes;
+	size_t indexBytes = h.fileLines.capacity() * sizeof(HistoryStore::LineSpan);
+
+	auto perEntry = [](size_t bytes, size_t count) {
+		if (count == 0) return std::string("-");
+		char buf[32];
+		std::snprintf(buf, sizeof(buf), "%.1f", bytes / static_cast<double>(count));
+		return std::string(buf);
+	};
+
+	std::cout << "file entries     " << h.fileLines.size() << " (loaded " << h.fileData.size() << " bytes, line index "
+		<< indexBytes << " bytes)" << std::endl;
+	std::cout << "session entries  " << h.sessionCount() << " (" << h.texts.size() << " unique)" << std::endl;
+	std::cout << "text arena       " << arenaBytes << " bytes" << std::endl;
+	std::cout << "dedup table      " << tableBytes << " bytes" << std::endl;
+	std::cout << "entry ids        " << idBytes << " bytes" << std::endl;
+	std::cout << "bytes/entry      " << perEntry(sessionBytes, h.sessionCount()) << " (std::string per entry: "
+		<< perEntry(stringBytes, h.sessionCount()) << ")" << std::endl;
+}
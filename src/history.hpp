@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <sys/types.h>
+#include <vector>
+
+//=============================================================================
+// 命令历史记录
+//=============================================================================
+
+// 历史记录存储：HISTFILE 的内容 + 本次会话新增的命令
+// 启动时把文件一次读入 shell 自己的缓冲区，不拆分；行偏移从文件末尾向前按需建立索引
+// （上箭头只需要最近几条），字符串在显示或调出时才构造。
+// 不长期 mmap：其它进程截断或原地改写文件时，访问映射会收到 SIGBUS，已索引的偏移也会失效
+struct HistoryStore
+{
+	// 文件中一行的位置
+	struct LineSpan
+	{
+		size_t offset;
+		size_t length;
+	};
+
+	// 去重后的一段文本在 textArena 中的位置
+	struct TextSpan
+	{
+		uint32_t offset;
+		uint32_t length;
+	};
+
+	std::string fileData;                // 加载时读入的 HISTFILE 内容
+	bool fileLoaded{};
+	dev_t fileDev{};                     // 读入的是哪个文件（共享历史判断文件是否被替换）
+	ino_t fileIno{};
+	size_t unindexedEnd{};               // [0, unindexedEnd) 尚未建立索引
+	std::vector<LineSpan> fileLines;     // 倒序：fileLines[0] 是文件最后一行
+
+	// 本次会话新增的命令（包括 history -r 读入的）：不重复的文本连续存放在 textArena，
+	// 每条历史只记录文本编号，成百上千次的 ls、git status 只存一份
+	std::vector<char> textArena;
+	std::vector<TextSpan> texts;         // 不重复的文本
+	std::vector<uint32_t> textSlots;     // 开放寻址哈希表：texts 下标 + 1，0 为空槽
+	std::vector<uint32_t> sessionLines;  // 每条历史对应的文本编号
+
+	size_t generation{};                 // 会话记录的下标变化时递增（erasedups、共享历史插入、clear）
+	size_t fileGeneration{};             // 文件部分被替换时递增（clear、重新加载）
+
+	HistoryStore() = default;
+	HistoryStore(const HistoryStore&) = delete;
+	HistoryStore& operator=(const HistoryStore&) = delete;
+
+	// 读入文件作为历史记录的开头，失败或文件为空返回 false
+	bool loadFile(const std::string& filePath);
+
+	// 总条数（需要为整个文件建立索引，只在 history 列表等场合调用）
+	size_t size();
+	bool empty();
+
+	// 第 i 条（从 0 开始，最旧的在前）
+	std::string operator[](size_t i);
+
+	// 第 i 条的视图，不复制（指向文件内容或文本区，push_back/clear 后失效）
+	std::string_view view(size_t i);
+
+	// 倒数第 k+1 条（k = 0 为最新），不存在返回 false；只为需要的部分建立索引
+	bool recent(size_t k, std::string& entry);
+
+	void push_back(std::string_view entry);
+	void clear();
+
+	// 删除会话记录中与 entry 相同的条目，返回被删除条目中下标小于 limit 的个数
+	size_t eraseSession(std::string_view entry, size_t limit);
+
+	// 本次会话新增的条数与第 i 条
+	size_t sessionCount() const { return sessionLines.size(); }
+	std::string_view sessionView(size_t i) const;
+
+	// 从文件末尾向前建立索引，直到至少有 count 行或到达文件开头
+	void indexTail(size_t count);
+
+	// 文件部分第 i 行（正序）
+	std::string_view fileLine(size_t i) const;
+
+	// 查找或加入文本，返回文本编号
+	uint32_t intern(std::string_view text);
+	std::string_view text(uint32_t id) const;
+};
+
+// 命令历史记录
+extern HistoryStore commandHistory;
+// 记录上次 history -a 追加到文件的位置（本次会话新增命令中的下标）
+extern size_t lastAppendedIndex;
+
+// 按 HISTCONTROL（ignorespace、ignoredups、ignoreboth、erasedups，冒号分隔）记录一条命令
+void addHistoryEntry(std::string_view line);
+
+// 从文件加载历史记录：历史为空时直接作为文件部分（不拆分），否则读入并追加到会话记录
+void loadHistoryFromFile(const std::string& filePath);
+
+// 将全部历史记录写入文件（写临时文件后 rename，其它会话不会读到写了一半的文件）
+void saveHistoryToFile(const std::string& filePath);
+
+// 将本次会话从 sessionStart 开始的命令以一次 O_APPEND write 追加到文件（持有 flock 排他锁）
+void appendHistoryToFile(const std::string& filePath, size_t sessionStart);
+
+// 共享历史（shopt -s sharehistory）：在一次排他锁内读入其它会话追加的新行（从上次读到的偏移开始），
+// 并追加本会话尚未写入的命令。每次记录命令后和显示提示符前调用
+void syncSharedHistory(const std::string& filePath);
+
+// history --stats：各部分占用的内存，以及每条命令一个 std::string 时的估算
+void printHistoryStats();
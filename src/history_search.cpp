@@ -0,0 +1,130 @@
+#include "history_search.hpp"
+#include "history.hpp"
+
+#include <algorithm>
+#include <cstdint>     // UINT32_MAX
+
+HistorySearchIndex historySearchIndex;
+
+// 三个字节组成一个 trigram 键
+uint32_t trigramKey(const char* p)
+{
+	return static_cast<uint32_t>(static_cast<unsigned char>(p[0])) << 16 |
+		static_cast<uint32_t>(static_cast<unsigned char>(p[1])) << 8 |
+		static_cast<uint32_t>(static_cast<unsigned char>(p[2]));
+}
+
+// 字符串中所有不重复的 trigram
+void collectTrigrams(std::string_view text, std::vector<uint32_t>& keys)
+{
+	keys.clear();
+	for (size_t i = 0; i + 3 <= text.length(); ++i)
+	{
+		keys.push_back(trigramKey(text.data() + i));
+	}
+	std::sort(keys.begin(), keys.end());
+	keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+}
+
+// 为新增的条目建立索引：generation 变化（下标已变）或条目变少时先清空
+// entry(i) 返回第 i 条的文本
+template <typename Entry>
+void updateTrigramIndex(TrigramIndex& index, size_t generation, size_t count, Entry&& entry)
+{
+	if (count < index.indexedCount || index.generation != generation)
+	{
+		index.postings.clear();
+		index.indexedCount = 0;
+		index.generation = generation;
+	}
+
+	std::vector<uint32_t> keys;
+	for (size_t i = index.indexedCount; i < count; ++i)
+	{
+		collectTrigrams(entry(i), keys);
+		for (uint32_t key : keys)
+		{
+			index.postings[key].push_back(static_cast<uint32_t>(i));
+		}
+	}
+	index.indexedCount = count;
+}
+
+// 为新增的历史记录建立索引（第一次搜索时建立全部，之后只处理新增部分）
+void updateHistorySearchIndex()
+{
+	commandHistory.indexTail(SIZE_MAX);
+	updateTrigramIndex(historySearchIndex.file, commandHistory.fileGeneration, commandHistory.fileLines.size(),
+		[](size_t i) { return commandHistory.fileLine(i); });
+	updateTrigramIndex(historySearchIndex.session, commandHistory.generation, commandHistory.sessionCount(),
+		[](size_t i) { return commandHistory.sessionView(i); });
+}
+
+// 在一部分的下标 before 之前（不含）查找包含 query（至少三个字节）的最近一条
+template <typename Entry>
+bool searchTrigramIndex(const TrigramIndex& index, Entry&& entry, std::string_view query, size_t before, size_t& found)
+{
+	std::vector<uint32_t> keys;
+	collectTrigrams(query, keys);
+	std::vector<const std::vector<uint32_t>*> lists;
+	for (uint32_t key : keys)
+	{
+		auto it = index.postings.find(key);
+		if (it == index.postings.end()) return false;
+		lists.push_back(&it->second);
+	}
+	std::sort(lists.begin(), lists.end(), [](auto* a, auto* b) { return a->size() < b->size(); });
+
+	// 沿最短的倒排表从新到旧，其它表用二分查找确认，最后验证子串（trigram 都在不代表相邻）
+	const std::vector<uint32_t>& shortest = *lists[0];
+	auto end = std::lower_bound(shortest.begin(), shortest.end(), static_cast<uint32_t>(std::min<size_t>(before, UINT32_MAX)));
+	for (auto it = end; it != shortest.begin();)
+	{
+		uint32_t candidate = *--it;
+		bool inAll = std::all_of(lists.begin() + 1, lists.end(), [candidate](auto* list) {
+			return std::binary_search(list->begin(), list->end(), candidate);
+		});
+		if (inAll && entry(candidate).find(query) != std::string_view::npos)
+		{
+			found = candidate;
+			return true;
+		}
+	}
+	return false;
+}
+
+// 在下标 before 之前（不含）查找包含 query 的最近一条历史记录
+bool searchHistoryBackward(std::string_view query, size_t before, size_t& found)
+{
+	updateHistorySearchIndex();
+	size_t fileCount = historySearchIndex.file.indexedCount;
+	before = std::min(before, fileCount + historySearchIndex.session.indexedCount);
+
+	// 少于三个字节无法使用索引：从新到旧扫描，通常很快就能命中
+	if (query.length() < 3)
+	{
+		for (size_t i = before; i > 0; --i)
+		{
+			if (commandHistory.view(i - 1).find(query) != std::string_view::npos)
+			{
+				found = i - 1;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// 会话记录比文件中的更新，先查会话部分
+	if (before > fileCount)
+	{
+		size_t sessionFound;
+		if (searchTrigramIndex(historySearchIndex.session, [](size_t i) { return commandHistory.sessionView(i); },
+			query, before - fileCount, sessionFound))
+		{
+			found = fileCount + sessionFound;
+			return true;
+		}
+		before = fileCount;
+	}
+	return searchTrigramIndex(historySearchIndex.file, [](size_t i) { return commandHistory.fileLine(i); }, query, before, found);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+//=============================================================================
+// 历史记录搜索（Ctrl-R）
+//=============================================================================
+
+// 三字母组（trigram）倒排索引：每个 trigram 对应包含它的条目下标（升序）
+// 查询时取查询串中最短的倒排表逐个验证，不需要线性扫描全部历史
+struct TrigramIndex
+{
+	std::unordered_map<uint32_t, std::vector<uint32_t>> postings;
+	size_t indexedCount{}; // 已建立索引的条数
+	size_t generation{};   // 建立索引时对应部分的 generation，不同则重建这一部分
+};
+
+// 文件部分和会话记录分别建立索引：erasedups、共享历史插入只改变会话记录的下标，
+// 只需重建（通常很小的）会话部分，HISTFILE 的几十万行保持不变
+struct HistorySearchIndex
+{
+	TrigramIndex file;    // 下标为文件部分的行号
+	TrigramIndex session; // 下标为会话记录中的序号
+};
+
+extern HistorySearchIndex historySearchIndex;
+
+// 为新增的历史记录建立索引（第一次搜索时建立全部，之后只处理新增部分）
+void updateHistorySearchIndex();
+
+// 在下标 before 之前（不含）查找包含 query 的最近一条历史记录
+// 找到返回 true 并设置 found
+bool searchHistoryBackward(std::string_view query, size_t before, size_t& found);
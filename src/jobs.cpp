@@ -0,0 +1,527 @@
+#include "jobs.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>    // from_chars() - wait 的进程号
+#include <cstdio>      // snprintf()
+#include <cstring>     // strsignal()
+#include <fcntl.h>
+#include <iostream>
+#include <sys/wait.h>  // waitpid()
+#include <unistd.h>    // pipe2(), tcsetpgrp()
+
+bool jobControlEnabled = false;
+std::vector<Job> jobTable;
+pid_t lastBackgroundPid = 0;
+
+// 非交互模式下最多保留多少个已结束、尚未被 wait 收集的作业
+constexpr size_t MAX_FINISHED_JOBS = 1024;
+
+// SIGCHLD 处理函数只向管道写一个字节，真正的回收在主循环中进行
+int childNotifyPipe[2] = { -1, -1 };
+pid_t shellPgid = 0;
+struct termios shellTmodes;
+
+void onSigchld(int)
+{
+	int savedErrno = errno;
+	char byte = 0;
+	write(childNotifyPipe[1], &byte, 1); // 非阻塞：管道满时丢弃，已有未处理的通知
+	errno = savedErrno;
+}
+
+// shell 在作业控制下忽略、子进程需要恢复为默认处理的信号
+sigset_t jobControlSignals()
+{
+	sigset_t set;
+	sigemptyset(&set);
+	for (int sig : { SIGINT, SIGQUIT, SIGTSTP, SIGTTIN, SIGTTOU })
+	{
+		sigaddset(&set, sig);
+	}
+	return set;
+}
+
+// 初始化子进程回收（SIGCHLD + self-pipe），interactive 时同时启用作业控制
+void initJobControl(bool interactive)
+{
+	if (pipe2(childNotifyPipe, O_CLOEXEC | O_NONBLOCK) == 0)
+	{
+		struct sigaction action{};
+		action.sa_handler = onSigchld;
+		sigemptyset(&action.sa_mask);
+		action.sa_flags = SA_RESTART; // 不设 SA_NOCLDSTOP：子进程挂起也要通知
+		sigaction(SIGCHLD, &action, nullptr);
+	}
+
+	if (!interactive) return;
+
+	// 在后台被启动时等待成为前台进程组，避免与父 shell 争抢终端
+	while (tcgetpgrp(STDIN_FILENO) != (shellPgid = getpgrp()))
+	{
+		kill(-shellPgid, SIGTTIN);
+	}
+
+	// Ctrl-C / Ctrl-Z 只发给前台作业，shell 自己不受影响
+	struct sigaction ignore{};
+	ignore.sa_handler = SIG_IGN;
+	for (int sig : { SIGINT, SIGQUIT, SIGTSTP, SIGTTIN, SIGTTOU })
+	{
+		sigaction(sig, &ignore, nullptr);
+	}
+
+	// 成为自己进程组的组长并取得终端（已是会话首进程时 setpgid 失败，无影响）
+	shellPgid = getpid();
+	setpgid(shellPgid, shellPgid);
+	shellPgid = getpgrp();
+	tcsetpgrp(STDIN_FILENO, shellPgid);
+	tcgetattr(STDIN_FILENO, &shellTmodes);
+	jobControlEnabled = true;
+}
+
+// SIGCHLD 到达时变为可读的 fd，行编辑器等待输入时一并 poll
+int childNotifyFd()
+{
+	return childNotifyPipe[0];
+}
+
+Job* findJobByPid(pid_t pid)
+{
+	for (auto& job : jobTable)
+	{
+		if (std::find(job.pids.begin(), job.pids.end(), pid) != job.pids.end()) return &job;
+	}
+	return nullptr;
+}
+
+// 记录一个子进程的状态变化（waitpid 得到的，不属于当前前台管道的进程）
+void noteChildStatus(pid_t pid, int status)
+{
+	Job* job = findJobByPid(pid);
+	if (job == nullptr) return;
+
+	if (WIFSTOPPED(status))
+	{
+		if (job->state != JobState::Stopped) job->notified = false;
+		job->state = JobState::Stopped;
+		return;
+	}
+	if (WIFCONTINUED(status))
+	{
+		job->state = JobState::Running;
+		return;
+	}
+
+	// 退出或被信号终止
+	if (pid == job->lastPid) job->status = status;
+	job->pids.erase(std::find(job->pids.begin(), job->pids.end(), pid));
+	if (job->pids.empty())
+	{
+		job->state = JobState::Done;
+		job->notified = false;
+	}
+}
+
+// 非阻塞回收所有已结束/挂起/继续的子进程，更新作业表
+void reapJobs()
+{
+	char buf[64];
+	while (read(childNotifyPipe[0], buf, sizeof(buf)) > 0) {}
+
+	while (true)
+	{
+		int status = 0;
+		pid_t pid = waitpid(-1, &status, WNOHANG | WUNTRACED | WCONTINUED);
+		if (pid <= 0) break;
+		noteChildStatus(pid, status);
+	}
+}
+
+// 作业状态的文字描述
+std::string jobStateText(const Job& job)
+{
+	switch (job.state)
+	{
+	case JobState::Running: return "Running";
+	case JobState::Stopped: return "Stopped";
+	case JobState::Done: break;
+	}
+	if (WIFSIGNALED(job.status)) return strsignal(WTERMSIG(job.status));
+	if (WIFEXITED(job.status) && WEXITSTATUS(job.status) != 0) return "Exit " + std::to_string(WEXITSTATUS(job.status));
+	return "Done";
+}
+
+// 当前作业（+）是最后加入的，前一个作业（-）是倒数第二个
+char jobMarker(const Job& job)
+{
+	if (!jobTable.empty() && &job == &jobTable.back()) return '+';
+	if (jobTable.size() >= 2 && &job == &jobTable[jobTable.size() - 2]) return '-';
+	return ' ';
+}
+
+// waitpid 格式的状态转换为退出状态（$?）：被信号终止或挂起时为 128 + 信号
+int exitCodeFromStatus(int status)
+{
+	if (WIFEXITED(status)) return WEXITSTATUS(status);
+	if (WIFSIGNALED(status)) return 128 + WTERMSIG(status);
+	if (WIFSTOPPED(status)) return 128 + WSTOPSIG(status);
+	return 0;
+}
+
+// 前台作业被信号终止：Ctrl-C 只换行，其它信号（SIGPIPE 除外）输出信号说明，如 Killed
+void reportSignalStatus(int status)
+{
+	if (!WIFSIGNALED(status)) return;
+
+	int sig = WTERMSIG(status);
+	if (sig == SIGINT)
+		std::cout << std::endl;
+	else if (sig != SIGPIPE)
+		std::cerr << strsignal(sig) << (WCOREDUMP(status) ? " (core dumped)" : "") << std::endl;
+}
+
+// 输出 "[1]+  Stopped    cmd" 形式的状态行
+void printJobStatus(const Job& job)
+{
+	char line[64];
+	std::snprintf(line, sizeof(line), "[%d]%c  %-24s", job.id, jobMarker(job), jobStateText(job).c_str());
+	std::cout << line << job.command << (job.state == JobState::Running ? " &" : "") << std::endl;
+}
+
+// 报告状态发生变化的作业（Done、Stopped），并删除已结束的作业；显示提示符前调用
+// 非交互模式不报告，已结束的作业保留到被 wait 收集（积累过多时丢弃最早的）
+void notifyJobChanges()
+{
+	reapJobs();
+	for (auto& job : jobTable)
+	{
+		if (job.notified) continue;
+		if (jobControlEnabled) printJobStatus(job);
+		job.notified = true;
+	}
+	if (jobControlEnabled)
+	{
+		std::erase_if(jobTable, [](const Job& job) { return job.state == JobState::Done; });
+		return;
+	}
+
+	size_t finished = std::count_if(jobTable.begin(), jobTable.end(), [](const Job& job) { return job.state == JobState::Done; });
+	for (auto it = jobTable.begin(); finished > MAX_FINISHED_JOBS && it != jobTable.end();)
+	{
+		if (it->state != JobState::Done)
+		{
+			++it;
+			continue;
+		}
+		it = jobTable.erase(it);
+		finished--;
+	}
+}
+
+// 把终端交给前台进程组
+void giveTerminalTo(pid_t pgid)
+{
+	if (jobControlEnabled) tcsetpgrp(STDIN_FILENO, pgid);
+}
+
+// 收回终端给 shell，并恢复 shell 的终端设置（前台程序可能改过，如 vim 被挂起时）
+void reclaimTerminal()
+{
+	if (!jobControlEnabled) return;
+	tcsetpgrp(STDIN_FILENO, shellPgid);
+	tcsetattr(STDIN_FILENO, TCSADRAIN, &shellTmodes);
+}
+
+// 加入作业表，返回作业
+Job& addJob(pid_t pgid, const std::vector<pid_t>& pids, pid_t lastPid, const std::string& command, JobState state)
+{
+	Job job;
+	job.id = jobTable.empty() ? 1 : jobTable.back().id + 1;
+	job.pgid = pgid;
+	job.command = command;
+	job.pids = pids;
+	job.lastPid = lastPid;
+	job.state = state;
+	job.notified = true; // 加入时由调用者报告
+	if (state == JobState::Stopped && jobControlEnabled)
+	{
+		job.hasTmodes = tcgetattr(STDIN_FILENO, &job.tmodes) == 0;
+	}
+	jobTable.push_back(std::move(job));
+	return jobTable.back();
+}
+
+// 用于显示的命令行：各命令的参数以空格连接，管道以 " | " 连接，复合命令显示为 { ...; } 或 ( ... )
+std::string describeCommands(const std::vector<CommandInfo>& commands)
+{
+	std::string text;
+	for (size_t i = 0; i < commands.size(); ++i)
+	{
+		if (i > 0) text += " | ";
+		if (commands[i].body >= 0) text += commands[i].subshell ? "( ... )" : "{ ...; }";
+		for (size_t j = 0; j < commands[i].args.size(); ++j)
+		{
+			if (j > 0) text += ' ';
+			text += commands[i].args[j].value;
+		}
+	}
+	return text;
+}
+
+//=============================================================================
+// jobs / fg / bg / wait
+//=============================================================================
+
+// 解析作业号：%n、n、%+、%%、%-，找不到时输出错误并返回 nullptr
+Job* findJobBySpec(std::string_view spec, const char* builtinName)
+{
+	std::string_view original = spec;
+	if (jobTable.empty())
+	{
+		std::cerr << builtinName << ": " << original << ": no such job" << std::endl;
+		return nullptr;
+	}
+	if (spec == "%+" || spec == "%%" || spec == "+") return &jobTable.back();
+	if (spec == "%-" || spec == "-") return jobTable.size() >= 2 ? &jobTable[jobTable.size() - 2] : &jobTable.back();
+	if (spec.starts_with('%')) spec.remove_prefix(1);
+
+	try
+	{
+		int id = std::stoi(std::string(spec));
+		for (auto& job : jobTable)
+		{
+			if (job.id == id) return &job;
+		}
+	}
+	catch (...) {}
+	std::cerr << builtinName << ": " << original << ": no such job" << std::endl;
+	return nullptr;
+}
+
+// fg / bg 的作业参数，省略时为当前作业
+Job* findJobSpec(const CommandInfo& cmdInfo, const char* builtinName)
+{
+	if (jobTable.empty())
+	{
+		std::cerr << builtinName << ": current: no such job" << std::endl;
+		return nullptr;
+	}
+	if (cmdInfo.args.size() < 2) return &jobTable.back();
+	return findJobBySpec(cmdInfo.args[1].value, builtinName);
+}
+
+// 执行 jobs 命令
+int executeJobs(const CommandInfo& cmdInfo)
+{
+	reapJobs();
+	bool pidsOnly = cmdInfo.args.size() >= 2 && cmdInfo.args[1].value == "-p";
+	bool withPid = cmdInfo.args.size() >= 2 && cmdInfo.args[1].value == "-l";
+	for (auto& job : jobTable)
+	{
+		if (pidsOnly)
+		{
+			std::cout << job.pgid << std::endl;
+			continue;
+		}
+		if (withPid)
+		{
+			char line[80];
+			std::snprintf(line, sizeof(line), "[%d]%c %d %-24s", job.id, jobMarker(job), job.pgid, jobStateText(job).c_str());
+			std::cout << line << job.command << std::endl;
+		}
+		else
+		{
+			printJobStatus(job);
+		}
+		job.notified = true;
+	}
+	std::erase_if(jobTable, [](const Job& job) { return job.state == JobState::Done; });
+	return 0;
+}
+
+// 执行 fg 命令：作业移到前台，等待它结束或再次挂起
+int executeFg(const CommandInfo& cmdInfo)
+{
+	if (!jobControlEnabled)
+	{
+		std::cerr << "fg: no job control" << std::endl;
+		return 1;
+	}
+	reapJobs(); // 先处理积压的挂起通知，避免继续后立即被误判为挂起
+	Job* job = findJobSpec(cmdInfo, "fg");
+	if (job == nullptr) return 1;
+
+	std::cout << job->command << std::endl;
+	giveTerminalTo(job->pgid);
+	if (job->hasTmodes) tcsetattr(STDIN_FILENO, TCSADRAIN, &job->tmodes);
+	if (job->state == JobState::Stopped) kill(-job->pgid, SIGCONT);
+	job->state = JobState::Running;
+
+	int id = job->id;
+	while (true)
+	{
+		int status = 0;
+		pid_t pid = waitpid(-1, &status, WUNTRACED);
+		if (pid == -1)
+		{
+			if (errno == EINTR) continue;
+			break;
+		}
+		noteChildStatus(pid, status);
+
+		auto it = std::find_if(jobTable.begin(), jobTable.end(), [id](const Job& j) { return j.id == id; });
+		if (it == jobTable.end() || it->state != JobState::Running) break;
+	}
+	reclaimTerminal();
+
+	auto it = std::find_if(jobTable.begin(), jobTable.end(), [id](const Job& j) { return j.id == id; });
+	if (it == jobTable.end()) return 0;
+	if (it->state == JobState::Stopped)
+	{
+		it->hasTmodes = tcgetattr(STDIN_FILENO, &it->tmodes) == 0;
+		// 挂起的作业成为当前作业
+		Job stopped = std::move(*it);
+		jobTable.erase(it);
+		jobTable.push_back(std::move(stopped));
+		std::cout << std::endl;
+		printJobStatus(jobTable.back());
+		return 128 + SIGTSTP;
+	}
+	else if (it->state == JobState::Done)
+	{
+		// 前台结束的作业不再报告
+		int status = it->status;
+		reportSignalStatus(status);
+		jobTable.erase(it);
+		return exitCodeFromStatus(status);
+	}
+	return 0;
+}
+
+// 执行 bg 命令：让挂起的作业在后台继续运行
+int executeBg(const CommandInfo& cmdInfo)
+{
+	if (!jobControlEnabled)
+	{
+		std::cerr << "bg: no job control" << std::endl;
+		return 1;
+	}
+	reapJobs();
+	Job* job = findJobSpec(cmdInfo, "bg");
+	if (job == nullptr) return 1;
+
+	if (job->state == JobState::Running)
+	{
+		std::cerr << "bg: job " << job->id << " already in background" << std::endl;
+		return 0;
+	}
+	kill(-job->pgid, SIGCONT);
+	job->state = JobState::Running;
+	std::cout << "[" << job->id << "]" << jobMarker(*job) << " " << job->command << " &" << std::endl;
+	return 0;
+}
+
+// wait 期间收到 SIGINT（交互模式下 shell 平时忽略它）
+volatile sig_atomic_t waitInterrupted = 0;
+
+void onWaitSigint(int)
+{
+	waitInterrupted = 1;
+}
+
+// 等待作业结束（作业控制下也在挂起时返回），返回退出状态；已结束的作业从作业表删除，不再报告
+int waitForJob(int id)
+{
+	while (true)
+	{
+		auto it = std::find_if(jobTable.begin(), jobTable.end(), [id](const Job& j) { return j.id == id; });
+		if (it == jobTable.end()) return 127;
+		if (it->state == JobState::Stopped) return 128 + SIGTSTP;
+		if (it->state == JobState::Done)
+		{
+			int status = it->status;
+			jobTable.erase(it);
+			return exitCodeFromStatus(status);
+		}
+		if (waitInterrupted) return 128 + SIGINT;
+
+		int status = 0;
+		pid_t pid = waitpid(-1, &status, jobControlEnabled ? WUNTRACED : 0);
+		if (pid == -1)
+		{
+			if (errno == EINTR) continue;
+			// 没有子进程了（已被其它地方回收）：作业不会再有状态变化
+			it->state = JobState::Done;
+			continue;
+		}
+		noteChildStatus(pid, status);
+	}
+}
+
+// 执行 wait 命令：wait 等待所有运行中的作业，状态为 0；wait %job|pid... 依次等待，状态为最后一个的退出状态
+// 不是本 shell 的作业或子进程时为 127
+int executeWait(const CommandInfo& cmdInfo)
+{
+	reapJobs();
+
+	// 交互模式下 Ctrl-C 打断等待（SIGINT 不设 SA_RESTART，waitpid 返回 EINTR）
+	struct sigaction previous{};
+	if (jobControlEnabled)
+	{
+		struct sigaction action{};
+		action.sa_handler = onWaitSigint;
+		sigemptyset(&action.sa_mask);
+		sigaction(SIGINT, &action, &previous);
+	}
+	waitInterrupted = 0;
+
+	int status = 0;
+	if (cmdInfo.args.size() < 2)
+	{
+		std::vector<int> ids;
+		for (const auto& job : jobTable)
+		{
+			if (job.state != JobState::Stopped) ids.push_back(job.id);
+		}
+		for (int id : ids)
+		{
+			if (waitForJob(id) == 128 + SIGINT && waitInterrupted) break;
+		}
+		status = waitInterrupted ? 128 + SIGINT : 0;
+	}
+
+	for (size_t i = 1; i < cmdInfo.args.size() && !waitInterrupted; ++i)
+	{
+		std::string_view operand = cmdInfo.args[i].value;
+		Job* job = nullptr;
+		if (operand.starts_with('%'))
+		{
+			job = findJobBySpec(operand, "wait");
+		}
+		else
+		{
+			pid_t pid = 0;
+			auto [end, ec] = std::from_chars(operand.data(), operand.data() + operand.size(), pid);
+			if (ec != std::errc() || end != operand.data() + operand.size())
+			{
+				std::cerr << "wait: `" << operand << "': not a pid or valid job spec" << std::endl;
+				status = 2;
+				continue;
+			}
+			for (auto& candidate : jobTable)
+			{
+				bool member = std::find(candidate.pids.begin(), candidate.pids.end(), pid) != candidate.pids.end();
+				if (candidate.lastPid == pid || candidate.pgid == pid || member) job = &candidate;
+			}
+			if (job == nullptr) std::cerr << "wait: pid " << pid << " is not a child of this shell" << std::endl;
+		}
+		status = job != nullptr ? waitForJob(job->id) : 127;
+	}
+
+	if (jobControlEnabled)
+	{
+		sigaction(SIGINT, &previous, nullptr);
+		if (waitInterrupted) std::cout << std::endl; // 与前台作业被 Ctrl-C 终止时一样只换行
+	}
+	return status;
+}
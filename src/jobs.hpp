@@ -0,0 +1,85 @@
+#pragma once
+
+#include "parser.hpp"
+
+#include <csignal>
+#include <string>
+#include <sys/types.h>
+#include <termios.h>
+#include <vector>
+
+//=============================================================================
+// 作业控制
+//=============================================================================
+
+enum class JobState
+{
+	Running,
+	Stopped,
+	Done
+};
+
+// 一个作业：一条管道中的所有进程，属于同一个进程组
+struct Job
+{
+	int id{};
+	pid_t pgid{};
+	std::string command;     // 显示用的命令行
+	std::vector<pid_t> pids; // 尚未结束的进程
+	pid_t lastPid{};         // 管道最后一段，其退出状态即作业的状态
+	int status{};            // lastPid 的 waitpid 状态
+	JobState state{ JobState::Running };
+	bool notified{};         // 状态变化已报告
+	struct termios tmodes{}; // 作业被挂起时的终端设置，fg 时恢复
+	bool hasTmodes{};
+};
+
+// 交互模式下启用：shell 有自己的进程组，前台作业通过 tcsetpgrp 获得终端
+extern bool jobControlEnabled;
+extern std::vector<Job> jobTable;
+// 最近一个后台作业最后一段的进程号（$!），没有时为 0
+extern pid_t lastBackgroundPid;
+
+// 初始化子进程回收（SIGCHLD + self-pipe），interactive 时同时启用作业控制
+void initJobControl(bool interactive);
+
+// SIGCHLD 到达时变为可读的 fd，行编辑器等待输入时一并 poll
+int childNotifyFd();
+
+// shell 在作业控制下忽略、子进程需要恢复为默认处理的信号
+sigset_t jobControlSignals();
+
+// 记录一个子进程的状态变化（waitpid 得到的，不属于当前前台管道的进程）
+void noteChildStatus(pid_t pid, int status);
+
+// 非阻塞回收所有已结束/挂起/继续的子进程，更新作业表
+void reapJobs();
+
+// 报告状态发生变化的作业（Done、Stopped），并删除已结束的作业；显示提示符前调用
+// 非交互模式不报告，已结束的作业保留到被 wait 收集（积累过多时丢弃最早的）
+void notifyJobChanges();
+
+// 把终端交给前台进程组 / 收回给 shell（并恢复 shell 的终端设置）
+void giveTerminalTo(pid_t pgid);
+void reclaimTerminal();
+
+// 加入作业表，返回作业
+Job& addJob(pid_t pgid, const std::vector<pid_t>& pids, pid_t lastPid, const std::string& command, JobState state);
+
+// 前台作业被信号终止：Ctrl-C 只换行，其它信号（SIGPIPE 除外）输出信号说明，如 Killed
+void reportSignalStatus(int status);
+
+// 输出 "[1]+  Stopped    cmd" 形式的状态行
+void printJobStatus(const Job& job);
+
+// 用于显示的命令行：各命令的参数以空格连接，管道以 " | " 连接，复合命令显示为 { ...; } 或 ( ... )
+std::string describeCommands(const std::vector<CommandInfo>& commands);
+
+// waitpid 格式的状态转换为退出状态（$?）：被信号终止或挂起时为 128 + 信号
+int exitCodeFromStatus(int status);
+
+// 执行 jobs / fg / bg / wait 命令，返回退出状态（fg、wait 为作业的退出状态）
+int executeJobs(const CommandInfo& cmdInfo);
+int executeFg(const CommandInfo& cmdInfo);
+int executeBg(const CommandInfo& cmdInfo);
+int executeWait(const CommandInfo& cmdInfo);
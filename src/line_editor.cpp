@@ -0,0 +1,914 @@
+#include "line_editor.hpp"
+#include "completion.hpp"
+#include "history.hpp"
+#include "history_search.hpp"
+#include "jobs.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>      // 等待后台补全扫描的时限
+#include <cstring>
+#include <cwchar>      // mbrtowc(), wcwidth() - 计算字符显示宽度
+#include <iostream>
+#include <memory>
+#include <poll.h>      // poll() - 等待转义序列剩余字节
+#include <set>
+#include <string_view>
+#include <sys/ioctl.h> // ioctl(TIOCGWINSZ) - 终端宽度
+#include <termios.h>   // termios for raw mode
+#include <unistd.h>
+#include <vector>
+
+// Enable raw mode for terminal
+struct termios orig_termios;
+
+//=============================================================================
+// 终端原始模式
+//=============================================================================
+
+//ICANON (规范模式) - 默认情况下，终端会等用户按回车才把整行输入发给程序。关闭后，程序可以逐字符读取，包括 TAB 键
+//ECHO - 默认终端会自动显示用户输入。关闭后，我们需要手动控制显示，这样才能在补全时正确更新显示内容
+
+// 括号粘贴模式（bracketed paste）：终端把粘贴内容包在 ESC[200~ ... ESC[201~ 之间发送
+const char BRACKETED_PASTE_ON[] = "\x1b[?2004h";
+const char BRACKETED_PASTE_OFF[] = "\x1b[?2004l";
+
+void disableRawMode()
+{
+	write(STDOUT_FILENO, BRACKETED_PASTE_OFF, sizeof(BRACKETED_PASTE_OFF) - 1);
+	// TCSADRAIN 而不是 TCSAFLUSH：不丢弃已缓冲但尚未处理的输入
+	tcsetattr(STDIN_FILENO, TCSADRAIN, &orig_termios);
+}
+
+void enableRawMode()
+{
+	tcgetattr(STDIN_FILENO, &orig_termios);   // 保存当前终端设置
+	struct termios raw = orig_termios;        // 复制一份用于修改
+	raw.c_lflag &= ~(ICANON | ECHO | ISIG);   // 关闭 ISIG：编辑时 Ctrl-C 作为普通按键读入（shell 忽略 SIGINT）
+	tcsetattr(STDIN_FILENO, TCSADRAIN, &raw); // 应用新设置
+	write(STDOUT_FILENO, BRACKETED_PASTE_ON, sizeof(BRACKETED_PASTE_ON) - 1);
+}
+
+//=============================================================================
+// 按键读取与转义序列解码
+//=============================================================================
+
+// \x1b 是 ESC 字符（ASCII 码 27，十六进制 0x1B）。
+// 当用户按下方向键等功能键时，终端不会发送单个字符，而是发送一个 ESC 序列：
+
+// 按键		    发送的序列		 字符表示
+// 上箭头		ESC [ A			\x1b[A
+// 下箭头		ESC [ B			\x1b[B
+// 右箭头		ESC [ C			\x1b[C
+// 左箭头		ESC [ D			\x1b[D
+// Ctrl+右		ESC [ 1 ; 5 C	\x1b[1;5C   （CSI 带参数，第二个参数为修饰键）
+// Home/End		ESC [ H / F		或 ESC [ 1 ~ / ESC [ 4 ~，或 SS3 形式 ESC O H / F
+// Delete		ESC [ 3 ~
+// 粘贴开始		ESC [ 200 ~		粘贴结束 ESC [ 201 ~
+
+enum class KeyType
+{
+	Text,      // 一段连续的可打印字符
+	Paste,     // 括号粘贴的内容
+	Enter,
+	Tab,
+	Backspace,
+	Delete,
+	Up,
+	Down,
+	Left,
+	Right,
+	Home,
+	End,
+	Escape,    // 单独按下的 ESC
+	Control,   // 其它 Ctrl+字母，ch 为原始控制字符
+	Unknown,   // 无法识别的转义序列（已完整跳过）
+	CompletionUpdate, // 不是按键：后台文件名补全扫描有新结果
+	Eof
+};
+
+struct KeyEvent
+{
+	KeyType type;
+	std::string text;  // Text / Paste 的内容
+	char ch{};         // Control 的控制字符
+	int modifiers{};   // CSI 修饰键参数（2=Shift, 3=Alt, 5=Ctrl ...），无则为 0
+};
+
+// 从终端读取按键：每次 read() 读取所有可用字节，从缓冲区中解码完整的 CSI/SS3 序列
+struct KeyReader
+{
+	int fd{ STDIN_FILENO };
+	std::vector<char> buffer = std::vector<char>(4096);
+	size_t pos{};
+	size_t len{};
+	bool completionReady{}; // fill() 因补全通知而返回
+
+	size_t available() const { return len - pos; }
+
+	// 读取更多字节到缓冲区；timeoutMs < 0 表示阻塞等待，超时或 EOF 返回 false
+	// wakeOnCompletion：阻塞等待时后台补全扫描有通知也返回 false，并设置 completionReady
+	bool fill(int timeoutMs = -1, bool wakeOnCompletion = false)
+	{
+		if (pos == len)
+		{
+			pos = len = 0;
+		}
+		else if (len == buffer.size())
+		{
+			// 缓冲区尾部已满：把未处理的数据移到开头
+			std::memmove(buffer.data(), buffer.data() + pos, len - pos);
+			len -= pos;
+			pos = 0;
+		}
+
+		if (timeoutMs >= 0)
+		{
+			struct pollfd pfd = { fd, POLLIN, 0 };
+			if (poll(&pfd, 1, timeoutMs) <= 0) return false;
+		}
+		else if (childNotifyFd() != -1 || (wakeOnCompletion && completionNotifyFd() != -1))
+		{
+			// 阻塞等待输入期间同时等待 SIGCHLD 通知，及时回收结束的后台作业；以及后台补全扫描的通知
+			int completionFd = wakeOnCompletion ? completionNotifyFd() : -1;
+			while (true)
+			{
+				struct pollfd pfds[3] = { { fd, POLLIN, 0 }, { childNotifyFd(), POLLIN, 0 }, { completionFd, POLLIN, 0 } };
+				if (poll(pfds, 3, -1) == -1 && errno != EINTR) break;
+				if (pfds[1].revents & POLLIN) reapJobs();
+				if (pfds[0].revents & (POLLIN | POLLHUP | POLLERR)) break;
+				if (pfds[2].revents & POLLIN)
+				{
+					drainCompletionNotify();
+					completionReady = true;
+					return false;
+				}
+			}
+		}
+
+		while (true)
+		{
+			ssize_t n = read(fd, buffer.data() + len, buffer.size() - len);
+			if (n < 0 && errno == EINTR) continue;
+			if (n <= 0) return false;
+			len += static_cast<size_t>(n);
+			return true;
+		}
+	}
+
+	// 确保缓冲区中至少有 count 个字节（转义序列剩余部分通常与 ESC 同时到达，最多等待 50ms）
+	bool ensure(size_t count)
+	{
+		while (available() < count)
+		{
+			if (!fill(50)) return false;
+		}
+		return true;
+	}
+
+	char peek(size_t offset = 0) const { return buffer[pos + offset]; }
+
+	// 解码 CSI 序列：ESC [ 参数字节(0x30-0x3F)* 中间字节(0x20-0x2F)* 结束字节(0x40-0x7E)
+	KeyEvent decodeCsi()
+	{
+		size_t i = 2;
+		while (true)
+		{
+			if (!ensure(i + 1))
+			{
+				// 序列不完整：丢弃已收到的部分
+				pos = len;
+				return { KeyType::Unknown };
+			}
+			unsigned char b = static_cast<unsigned char>(peek(i));
+			if (b >= 0x40 && b <= 0x7e) break;
+			if (b < 0x20 || b > 0x7e)
+			{
+				// 非法字节：只丢弃 ESC [，其余按普通输入处理
+				pos += 2;
+				return { KeyType::Unknown };
+			}
+			i++;
+		}
+
+		std::string params(buffer.data() + pos + 2, i - 2);
+		char final = peek(i);
+		pos += i + 1;
+
+		// 拆分数字参数，如 "1;5" -> {1, 5}
+		std::vector<int> nums;
+		int current = 0;
+		bool hasDigit = false;
+		for (char c : params)
+		{
+			if (c >= '0' && c <= '9')
+			{
+				current = current * 10 + (c - '0');
+				hasDigit = true;
+			}
+			else if (c == ';')
+			{
+				nums.push_back(hasDigit ? current : 0);
+				current = 0;
+				hasDigit = false;
+			}
+		}
+		if (hasDigit || !nums.empty()) nums.push_back(hasDigit ? current : 0);
+
+		KeyEvent key{ KeyType::Unknown };
+		key.modifiers = nums.size() >= 2 ? nums[1] : 0;
+
+		switch (final)
+		{
+		case 'A': key.type = KeyType::Up; break;
+		case 'B': key.type = KeyType::Down; break;
+		case 'C': key.type = KeyType::Right; break;
+		case 'D': key.type = KeyType::Left; break;
+		case 'H': key.type = KeyType::Home; break;
+		case 'F': key.type = KeyType::End; break;
+		case '~':
+			switch (nums.empty() ? 0 : nums[0])
+			{
+			case 1: case 7: key.type = KeyType::Home; break;
+			case 4: case 8: key.type = KeyType::End; break;
+			case 3: key.type = KeyType::Delete; break;
+			case 200: return readPaste();
+			default: break;
+			}
+			break;
+		default: break;
+		}
+		return key;
+	}
+
+	// 读取括号粘贴内容直到 ESC[201~，一次性返回
+	KeyEvent readPaste()
+	{
+		static const std::string PASTE_END = "\x1b[201~";
+		KeyEvent key{ KeyType::Paste };
+		while (true)
+		{
+			std::string_view data(buffer.data() + pos, available());
+			size_t end = data.find(PASTE_END);
+			if (end != std::string_view::npos)
+			{
+				key.text.append(data.substr(0, end));
+				pos += end + PASTE_END.length();
+				return key;
+			}
+
+			// 结束标记可能被拆在两次 read 之间：保留末尾可能是标记前缀的字节
+			size_t keep = std::min(data.length(), PASTE_END.length() - 1);
+			key.text.append(data.substr(0, data.length() - keep));
+			pos += data.length() - keep;
+			if (!fill()) 
+			{
+				key.text.append(buffer.data() + pos, available());
+				pos = len;
+				return key;
+			}
+		}
+	}
+
+	// 读取下一个按键事件
+	KeyEvent next()
+	{
+		if (available() == 0 && !fill(-1, true))
+		{
+			if (!completionReady) return { KeyType::Eof };
+			completionReady = false;
+			return { KeyType::CompletionUpdate };
+		}
+
+		unsigned char c = static_cast<unsigned char>(peek());
+
+		if (c == '\x1b')
+		{
+			if (!ensure(2))
+			{
+				pos++;
+				return { KeyType::Escape };
+			}
+			char kind = peek(1);
+			if (kind == '[') return decodeCsi();
+			if (kind == 'O')
+			{
+				// SS3 序列：ESC O 后跟一个字节
+				if (!ensure(3))
+				{
+					pos = len;
+					return { KeyType::Unknown };
+				}
+				char final = peek(2);
+				pos += 3;
+				switch (final)
+				{
+				case 'A': return { KeyType::Up };
+				case 'B': return { KeyType::Down };
+				case 'C': return { KeyType::Right };
+				case 'D': return { KeyType::Left };
+				case 'H': return { KeyType::Home };
+				case 'F': return { KeyType::End };
+				default: return { KeyType::Unknown };
+				}
+			}
+			// Alt+字符：忽略
+			pos += 2;
+			return { KeyType::Unknown };
+		}
+
+		if (c == '\n' || c == '\r') { pos++; return { KeyType::Enter }; }
+		if (c == '\t') { pos++; return { KeyType::Tab }; }
+		if (c == 127 || c == '\b') { pos++; return { KeyType::Backspace }; }
+		if (c < 32)
+		{
+			pos++;
+			KeyEvent key{ KeyType::Control };
+			key.ch = static_cast<char>(c);
+			return key;
+		}
+
+		// 连续的可打印字符（含 UTF-8 多字节字符）作为一个事件返回
+		size_t end = pos;
+		while (end < len)
+		{
+			unsigned char b = static_cast<unsigned char>(buffer[end]);
+			if (b < 32 || b == 127) break;
+			end++;
+		}
+		KeyEvent key{ KeyType::Text };
+		key.text.assign(buffer.data() + pos, end - pos);
+		pos = end;
+		return key;
+	}
+};
+
+KeyReader keyReader;
+
+//=============================================================================
+// 行编辑器显示刷新
+//=============================================================================
+
+// 屏幕上当前显示的内容，刷新时与新内容比较，只重绘变化的部分
+struct LineDisplay
+{
+	size_t promptWidth{ 2 }; // "$ "
+	std::string shown;       // 提示符之后已显示的输入
+	int columns{ 80 };       // 终端宽度
+};
+
+// 从 text 的 [0, len) 推算光标位置（行、列，相对提示符所在行的行首）
+// col == columns 表示光标停在行尾等待折行（终端的 pending wrap 状态）
+void advanceCursor(const std::string& text, size_t len, const LineDisplay& display, int& row, int& col)
+{
+	row = 0;
+	col = static_cast<int>(display.promptWidth);
+	size_t i = 0;
+	while (i < len)
+	{
+		unsigned char c = static_cast<unsigned char>(text[i]);
+		if (c == '\n')
+		{
+			row++;
+			col = 0;
+			i++;
+			continue;
+		}
+
+		// 解码一个 UTF-8 字符以获得显示宽度（中文等宽字符占两列）
+		wchar_t wc = c;
+		size_t charLen = 1;
+		if (c >= 0x80)
+		{
+			std::mbstate_t state{};
+			size_t n = std::mbrtowc(&wc, text.data() + i, len - i, &state);
+			if (n != static_cast<size_t>(-1) && n != static_cast<size_t>(-2) && n > 0) charLen = n;
+		}
+		int width = (c == '\t') ? 8 - col % 8 : wcwidth(wc);
+		if (width < 0) width = 1;
+		i += charLen;
+
+		if (col + width > display.columns)
+		{
+			row++;
+			col = 0;
+		}
+		col += width;
+	}
+}
+
+// 把屏幕上的输入更新为 input：构建好全部输出后只调用一次 write()
+// 公共前缀不重绘；光标移动到第一个不同的字符处，输出剩余部分并清除到屏幕末尾
+void refreshLine(LineDisplay& display, const std::string& input)
+{
+	size_t common = 0;
+	size_t limit = std::min(display.shown.length(), input.length());
+	while (common < limit && display.shown[common] == input[common]) common++;
+	// 回退到 UTF-8 字符边界
+	while (common > 0 && common < input.length() && (static_cast<unsigned char>(input[common]) & 0xC0) == 0x80) common--;
+
+	if (common == display.shown.length() && common == input.length()) return;
+
+	std::string out;
+	int curRow, curCol;
+	advanceCursor(display.shown, display.shown.length(), display, curRow, curCol);
+	if (curCol >= display.columns)
+	{
+		curCol = display.columns - 1;
+	}
+
+	if (common < display.shown.length())
+	{
+		// 移动光标到第一个不同字符的位置
+		int targetRow, targetCol;
+		advanceCursor(input, common, display, targetRow, targetCol);
+		if (targetCol >= display.columns)
+		{
+			targetRow++;
+			targetCol = 0;
+		}
+		if (curRow > targetRow)
+		{
+			out += "\x1b[" + std::to_string(curRow - targetRow) + "A";
+		}
+		out += '\r';
+		if (targetCol > 0)
+		{
+			out += "\x1b[" + std::to_string(targetCol) + "C";
+		}
+	}
+
+	// 输出变化部分，多行内容中的换行需要手动回到行首
+	for (size_t i = common; i < input.length(); ++i)
+	{
+		if (input[i] == '\n') out += '\r';
+		out += input[i];
+	}
+	if (common < display.shown.length())
+	{
+		out += "\x1b[J"; // 清除光标之后的所有内容（包括折行的残留）
+	}
+
+	// 恰好写满一行时光标处于 pending wrap 状态，主动换行使光标位置确定
+	int endRow, endCol;
+	advanceCursor(input, input.length(), display, endRow, endCol);
+	if (endCol >= display.columns)
+	{
+		out += "\r\n";
+	}
+
+	write(STDOUT_FILENO, out.data(), out.length());
+	display.shown = input;
+}
+
+// 把光标从当前显示内容的末尾移回提示符所在行的行首
+void moveToPromptStart(const LineDisplay& display, std::string& out)
+{
+	int row, col;
+	advanceCursor(display.shown, display.shown.length(), display, row, col);
+	if (col >= display.columns) row++; // refreshLine 已主动换行
+	if (row > 0) out += "\x1b[" + std::to_string(row) + "A";
+	out += '\r';
+}
+
+//=============================================================================
+// Ctrl-R 反向增量搜索
+//=============================================================================
+
+const char CTRL_C = '\x03';
+const char CTRL_G = '\x07';
+const char CTRL_R = '\x12';
+
+// 搜索模式：提示符替换为 (reverse-i-search)`query': 匹配项，每次按键通过索引重新查找
+// 结束搜索的按键放入 pending 交给主循环处理（Enter 直接执行）；返回匹配项下标，取消时返回 -1
+long reverseSearch(LineDisplay& display, std::string& input, KeyEvent& pending)
+{
+	std::string original = input;
+	std::string query;
+	size_t matchIndex = commandHistory.size();
+	bool hasMatch = false;
+	bool failed = false;
+
+	// 搜索行不带 "$ "，用单独的显示状态做差异刷新
+	LineDisplay searchDisplay;
+	searchDisplay.promptWidth = 0;
+	searchDisplay.columns = display.columns;
+	std::string out;
+	moveToPromptStart(display, out);
+	out += "\x1b[J";
+	write(STDOUT_FILENO, out.data(), out.length());
+
+	auto redraw = [&]() {
+		std::string line = failed ? "(failed reverse-i-search)`" : "(reverse-i-search)`";
+		line += query + "': ";
+		if (hasMatch) line += commandHistory.view(matchIndex);
+		refreshLine(searchDisplay, line);
+	};
+
+	// 从 before 之前查找，找不到时保留上一个匹配并标记失败
+	auto search = [&](size_t before) {
+		size_t found;
+		failed = !searchHistoryBackward(query, before, found);
+		if (!failed)
+		{
+			matchIndex = found;
+			hasMatch = true;
+		}
+	};
+
+	redraw();
+	long result = -1;
+	while (true)
+	{
+		KeyEvent key = keyReader.next();
+		if (key.type == KeyType::CompletionUpdate) continue;
+		if (key.type == KeyType::Text || key.type == KeyType::Paste)
+		{
+			for (char ch : key.text)
+			{
+				if (static_cast<unsigned char>(ch) >= 32) query += ch;
+			}
+			// 查询变长：当前匹配仍可能符合，从它开始（含）继续向前找
+			search(hasMatch ? matchIndex + 1 : commandHistory.size());
+		}
+		else if (key.type == KeyType::Backspace)
+		{
+			if (query.empty()) continue;
+			while (query.length() > 1 && (static_cast<unsigned char>(query.back()) & 0xC0) == 0x80)
+			{
+				query.pop_back();
+			}
+			query.pop_back();
+			hasMatch = false;
+			search(commandHistory.size());
+		}
+		else if (key.type == KeyType::Control && key.ch == CTRL_R)
+		{
+			// 再按 Ctrl-R：继续找更早的匹配
+			if (!query.empty()) search(hasMatch ? matchIndex : commandHistory.size());
+		}
+		else if (key.type == KeyType::Escape || (key.type == KeyType::Control && key.ch == CTRL_G))
+		{
+			// 取消：恢复原来的输入
+			input = original;
+			pending = { KeyType::Unknown };
+			break;
+		}
+		else
+		{
+			// 其它按键：接受匹配项，按键交给主循环处理
+			if (hasMatch)
+			{
+				input = commandHistory.view(matchIndex);
+				result = static_cast<long>(matchIndex);
+			}
+			pending = key;
+			break;
+		}
+		redraw();
+	}
+
+	// 恢复普通提示符
+	out.clear();
+	moveToPromptStart(searchDisplay, out);
+	out += "\x1b[J$ ";
+	write(STDOUT_FILENO, out.data(), out.length());
+	display.shown.clear();
+	refreshLine(display, input);
+	return result;
+}
+
+// 获取终端宽度
+int terminalColumns()
+{
+	struct winsize ws;
+	if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 0)
+	{
+		return ws.ws_col;
+	}
+	return 80;
+}
+
+//=============================================================================
+// Tab 补全
+//=============================================================================
+
+// 找到行尾正在输入的单词的起点（跳过引号和转义）；commandPosition 表示它是命令名而不是参数
+size_t completionWordStart(const std::string& input, bool& commandPosition)
+{
+	size_t start = 0;
+	commandPosition = true;
+	char quote = 0;
+	for (size_t i = 0; i < input.length(); ++i)
+	{
+		char c = input[i];
+		if (quote)
+		{
+			if (c == quote) quote = 0;
+			else if (c == '\\' && quote == '"') i++;
+			continue;
+		}
+		if (c == '\\')
+		{
+			i++;
+			continue;
+		}
+		if (c == '\'' || c == '"')
+		{
+			quote = c;
+			continue;
+		}
+		if (std::string_view(" \t\n;&|()<>").find(c) == std::string_view::npos) continue;
+
+		if (c == ' ' || c == '\t')
+		{
+			if (i > start) commandPosition = false; // 结束了一个单词
+		}
+		else
+		{
+			// ; & | ( 换行之后是新的命令，重定向 < > 之后是文件名
+			commandPosition = c != '<' && c != '>';
+		}
+		start = i + 1;
+	}
+	return start;
+}
+
+// 等待后台扫描完成，最多 timeoutMs 毫秒；期间有按键到达立即返回，按键交给主循环处理
+void waitForFileCompletion(const FileCompletion& completion, int timeoutMs)
+{
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+	while (!completion.done && keyReader.available() == 0)
+	{
+		auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+		if (remaining <= 0) break;
+		struct pollfd pfds[2] = { { keyReader.fd, POLLIN, 0 }, { completionNotifyFd(), POLLIN, 0 } };
+		if (poll(pfds, 2, static_cast<int>(remaining)) == -1 && errno != EINTR) break;
+		if (pfds[0].revents) break;
+		if (pfds[1].revents & POLLIN) drainCompletionNotify();
+	}
+}
+
+// 第二次按 Tab：在下一行列出所有匹配项，然后重新显示提示符和输入
+void listCompletions(const std::set<std::string>& matches, bool scanning, LineDisplay& display, const std::string& input)
+{
+	std::cout << std::endl;
+	bool first = true;
+	for (const auto& m : matches)
+	{
+		if (!first) std::cout << "  "; // 两个空格分隔
+		std::cout << m;
+		first = false;
+	}
+	if (scanning)
+	{
+		// 后台扫描尚未结束：这只是目前已读到的部分
+		std::cout << (first ? "" : "  ") << "(scanning...)";
+	}
+	std::cout << std::endl;
+	std::cout << "$ " << input;
+	std::cout.flush();
+	display.shown = input;
+}
+
+// Read a line with tab completion and history support
+std::string readLineWithCompletion()
+{
+	enableRawMode();
+	std::string input;
+	int tabCount = 0;        // 跟踪连续按 Tab 的次数
+	std::string lastInput;   // 记录上次按 Tab 时的输入
+	size_t historyBack = 0;  // 向前翻过的历史条数，0 表示正在编辑的新命令
+	std::string savedInput;  // 保存用户正在输入的内容
+	LineDisplay display;     // 屏幕显示状态
+	display.columns = terminalColumns();
+	
+	KeyEvent pendingKey;     // 搜索模式结束时留给主循环处理的按键
+	bool hasPendingKey = false;
+
+	std::shared_ptr<FileCompletion> fileCompletion; // 参数位置的文件名补全（后台扫描，完成后可用于更长的前缀）
+	bool completionPending = false; // 按 Tab 时扫描尚未完成：完成通知到达且输入未变时再补全
+	std::string completionInput;    // 发起补全时的输入
+
+	// 用候选项补全 input 中从 wordStart 开始的单词：唯一匹配直接补全，否则补全到最长公共前缀，
+	// 不能再补全时第一次按 Tab 响铃、第二次列出所有匹配项。scanning 表示候选项还不完整，只能列出
+	auto applyCompletion = [&](const std::set<std::string>& matches, size_t wordStart, const std::string& dirPart,
+		const std::string& prefix, bool scanning) {
+		std::string head = input.substr(0, wordStart) + dirPart;
+		if (matches.size() == 1 && !scanning)
+		{
+			// 唯一匹配：补全并添加空格（目录以 / 结尾，不加空格以便继续补全下一层）
+			const std::string& match = *matches.begin();
+			input = head + escapeCompletionWord(match);
+			if (!match.ends_with('/')) input += ' ';
+			refreshLine(display, input);
+			tabCount = 0; // 重置 tab 计数
+			lastInput = input;
+			return;
+		}
+
+		// 多个匹配：计算最长公共前缀
+		std::string lcp = longestCommonPrefix(matches);
+		if (!scanning && lcp.length() > prefix.length())
+		{
+			// 可以补全到更长的公共前缀
+			input = head + escapeCompletionWord(lcp);
+			refreshLine(display, input);
+			tabCount = 0; // 重置 tab 计数
+			lastInput = input;
+		}
+		else if (scanning ? tabCount >= 2 : !matches.empty() && tabCount >= 2)
+		{
+			listCompletions(matches, scanning, display, input);
+			tabCount = 0; // 重置 tab 计数
+		}
+		else if (!scanning && (matches.empty() || tabCount == 1))
+		{
+			// 没有匹配或第一次按 Tab：响铃
+			std::cout << '\x07';
+			std::cout.flush();
+		}
+	};
+
+	// 补全行尾的单词：命令名查 PATH 索引；参数查目录（后台扫描，短暂等待，未完成则在完成通知到达时补全）
+	auto completeWord = [&]() {
+		bool commandPosition;
+		size_t wordStart = completionWordStart(input, commandPosition);
+		std::string word = input.substr(wordStart);
+		completionPending = false;
+		if (commandPosition && word.find('/') == std::string::npos)
+		{
+			// Find matching builtin command or executable in PATH
+			applyCompletion(completeCommandName(word), wordStart, "", word, false);
+			return;
+		}
+
+		size_t slash = word.rfind('/');
+		std::string dirPart = slash == std::string::npos ? "" : word.substr(0, slash + 1);
+		std::string dir = unescapeCompletionWord(dirPart);
+		std::string prefix = unescapeCompletionWord(std::string_view(word).substr(dirPart.length()));
+
+		// 同一目录已完成的扫描直接复用；同一单词正在进行的扫描继续等待
+		bool reuse = fileCompletion && (fileCompletion->covers(dir, prefix)
+			|| (!fileCompletion->cancelled && fileCompletion->dir == dir && fileCompletion->prefix == prefix));
+		if (!reuse)
+		{
+			cancelFileCompletion(fileCompletion);
+			fileCompletion = startFileCompletion(dir, prefix);
+		}
+		// 小目录通常在这段时间内读完，与同步补全的体验相同；大目录或慢速文件系统不阻塞编辑
+		waitForFileCompletion(*fileCompletion, 200);
+
+		// 先读 done 再取结果：done 为 true 时取到的一定是完整结果
+		bool scanning = !fileCompletion->done;
+		std::set<std::string> matches;
+		{
+			std::lock_guard<std::mutex> lock(fileCompletion->mutex);
+			for (auto it = fileCompletion->matches.lower_bound(prefix);
+				it != fileCompletion->matches.end() && it->starts_with(prefix); ++it)
+			{
+				matches.insert(*it);
+			}
+		}
+		applyCompletion(matches, wordStart, dirPart, prefix, scanning);
+		completionPending = scanning;
+		completionInput = input;
+	};
+	
+	while (true)
+	{
+		KeyEvent key = hasPendingKey ? std::move(pendingKey) : keyReader.next();
+		hasPendingKey = false;
+
+		// 用户继续输入：取消尚未完成的扫描
+		if (key.type != KeyType::Tab && key.type != KeyType::CompletionUpdate && fileCompletion && !fileCompletion->done)
+		{
+			cancelFileCompletion(fileCompletion);
+			fileCompletion.reset();
+			completionPending = false;
+		}
+
+		if (key.type == KeyType::CompletionUpdate)
+		{
+			// 后台扫描完成且按 Tab 之后输入没有变化：补全
+			if (completionPending && fileCompletion && fileCompletion->done && input == completionInput)
+			{
+				completeWord();
+			}
+			continue;
+		}
+		if (key.type == KeyType::Eof)
+		{
+			disableRawMode();
+			return input;
+		}
+		
+		if (key.type == KeyType::Enter)
+		{
+			std::cout << std::endl;
+			break;
+		}
+		else if (key.type == KeyType::Up)
+		{
+			std::string entry;
+			if (commandHistory.recent(historyBack, entry))
+			{
+				// 如果是第一次按上箭头，保存当前输入
+				if (historyBack == 0)
+				{
+					savedInput = input;
+				}
+				
+				historyBack++;
+				
+				// 显示历史命令
+				input = std::move(entry);
+				refreshLine(display, input);
+			}
+		}
+		else if (key.type == KeyType::Down)
+		{
+			if (historyBack > 0)
+			{
+				historyBack--;
+				
+				if (historyBack == 0)
+				{
+					// 恢复用户原来的输入
+					input = savedInput;
+				}
+				else
+				{
+					commandHistory.recent(historyBack - 1, input);
+				}
+				refreshLine(display, input);
+			}
+		}
+		else if (key.type == KeyType::Tab)
+		{
+			// Tab completion
+			// 检查输入是否改变，如果改变则重置 tabCount
+			if (input != lastInput)
+			{
+				tabCount = 0;
+				lastInput = input;
+			}
+			tabCount++;
+			completeWord();
+		}
+		else if (key.type == KeyType::Backspace)
+		{
+			// Backspace：删除一个完整的 UTF-8 字符
+			if (!input.empty())
+			{
+				while (input.length() > 1 && (static_cast<unsigned char>(input.back()) & 0xC0) == 0x80)
+				{
+					input.pop_back();
+				}
+				input.pop_back();
+				refreshLine(display, input);
+			}
+		}
+		else if (key.type == KeyType::Text || key.type == KeyType::Paste)
+		{
+			// 普通输入或粘贴：整段插入，只输出一次
+			std::string text;
+			text.reserve(key.text.length());
+			for (char ch : key.text)
+			{
+				if (ch == '\r') ch = '\n';
+				if (static_cast<unsigned char>(ch) >= 32 || ch == '\n' || ch == '\t') text += ch;
+			}
+			// 粘贴末尾的换行不立即执行，等待用户按回车
+			while (!text.empty() && text.back() == '\n') text.pop_back();
+
+			input += text;
+			refreshLine(display, input);
+		}
+		else if (key.type == KeyType::Control && key.ch == CTRL_C)
+		{
+			// Ctrl-C：放弃当前输入，换行显示新的提示符
+			std::cout << "^C" << std::endl << "$ ";
+			std::cout.flush();
+			input.clear();
+			display.shown.clear();
+			historyBack = 0;
+		}
+		else if (key.type == KeyType::Control && key.ch == CTRL_R)
+		{
+			// Ctrl-R：反向增量搜索，接受的匹配项作为上下箭头的新起点
+			std::string before = input;
+			long match = reverseSearch(display, input, pendingKey);
+			hasPendingKey = true;
+			if (match >= 0)
+			{
+				if (historyBack == 0) savedInput = before;
+				historyBack = commandHistory.size() - match;
+			}
+		}
+		// 其它按键（Left/Right/Home/End/Delete 等）已完整解码，暂不处理
+	}
+	
+	disableRawMode();
+	return input;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <string>
+
+//=============================================================================
+// 行编辑器
+//=============================================================================
+
+// Read a line with tab completion and history support
+std::string readLineWithCompletion();
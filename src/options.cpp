@@ -0,0 +1,45 @@
+#include "options.hpp"
+
+#include <cstdlib>     // getenv()
+#include <string_view>
+
+bool optLastpipe = false;
+bool optShareHistory = false;
+bool optDotglob = false;
+bool optGlobstar = false;
+bool optNullglob = false;
+
+const std::vector<ShellOption> SHELL_OPTIONS = {
+	{ "dotglob", &optDotglob },
+	{ "globstar", &optGlobstar },
+	{ "lastpipe", &optLastpipe },
+	{ "nullglob", &optNullglob },
+	{ "sharehistory", &optShareHistory },
+};
+
+// 按名字查找选项，找不到返回 nullptr
+const ShellOption* findShellOption(const std::string& name)
+{
+	for (const auto& option : SHELL_OPTIONS)
+	{
+		if (name == option.name) return &option;
+	}
+	return nullptr;
+}
+
+// 启动时按环境变量 BASHOPTS（冒号分隔的选项名）打开选项
+void loadShellOptionsFromEnv()
+{
+	const char* env = std::getenv("BASHOPTS");
+	if (env == nullptr) return;
+
+	std::string_view names = env;
+	while (!names.empty())
+	{
+		size_t colon = names.find(':');
+		const ShellOption* option = findShellOption(std::string(names.substr(0, colon)));
+		if (option != nullptr) *option->value = true;
+		if (colon == std::string_view::npos) break;
+		names.remove_prefix(colon + 1);
+	}
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+//=============================================================================
+// shell 选项（shopt）
+//=============================================================================
+
+// lastpipe：管道的最后一段若是会修改 shell 状态的内置命令（如 cd），在 shell 进程中执行
+extern bool optLastpipe;
+// sharehistory：多个会话共享 HISTFILE，每条命令立即追加，显示提示符前读入其它会话的命令
+extern bool optShareHistory;
+// dotglob：路径名展开时 * ? [ 也匹配以 . 开头的文件名
+extern bool optDotglob;
+// globstar：路径名展开时单独的 ** 匹配任意层子目录
+extern bool optGlobstar;
+// nullglob：没有匹配的通配符单词展开为空，而不是保持原样
+extern bool optNullglob;
+
+struct ShellOption
+{
+	const char* name;
+	bool* value;
+};
+
+// 所有可由 shopt 设置的选项
+extern const std::vector<ShellOption> SHELL_OPTIONS;
+
+// 按名字查找选项，找不到返回 nullptr
+const ShellOption* findShellOption(const std::string& name);
+
+// 启动时按环境变量 BASHOPTS（冒号分隔的选项名）打开选项
+void loadShellOptionsFromEnv();
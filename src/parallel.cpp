@@ -0,0 +1,395 @@
+#include "parallel.hpp"
+#include "command_lookup.hpp"
+#include "executor.hpp"
+#include "variables.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <csignal>       // SIGINT
+#include <cstring>       // strerror()
+#include <deque>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sys/mman.h>    // memfd_create()
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <sys/wait.h>    // wait4()
+#include <thread>
+#include <unistd.h>
+
+//=============================================================================
+// 任务与工作窃取队列
+//=============================================================================
+
+// 一个任务的执行结果：输出暂存在 memfd 中，不能立即输出时读入内存
+struct ParallelResult
+{
+	int outFd{ -1 };
+	int errFd{ -1 };
+	std::string out;
+	std::string err;
+	bool done{};
+	bool failed{};
+};
+
+// 每个工作线程一个队列：自己从前端取（按输入顺序执行，-k 时等待输出的任务最少），
+// 其它线程从后端窃取
+struct WorkQueue
+{
+	std::mutex mutex;
+	std::deque<size_t> items;
+};
+
+struct ParallelRun
+{
+	std::vector<std::string> templateArgs;    // 命令模板
+	std::vector<std::string> items;           // 输入项
+	std::map<std::string, std::string> paths; // 命令名 -> 可执行文件路径（主线程预先查找）
+	std::vector<ParallelResult> results;
+	std::vector<WorkQueue> queues;
+	bool keepOrder{};
+	std::atomic<bool> cancelled{}; // 有任务被 SIGINT 终止（Ctrl-C）：不再取新任务
+
+	std::mutex emitMutex;
+	size_t nextToEmit{}; // -k：下一个应输出的任务
+};
+
+// 把输入项代入命令模板
+std::vector<std::string> expandTemplate(const std::vector<std::string>& templateArgs, const std::string& item)
+{
+	std::vector<std::string> args;
+	bool replaced = false;
+	for (const auto& arg : templateArgs)
+	{
+		std::string expanded;
+		size_t pos = 0;
+		while (true)
+		{
+			size_t found = arg.find("{}", pos);
+			if (found == std::string::npos) break;
+			expanded.append(arg, pos, found - pos);
+			expanded += item;
+			pos = found + 2;
+			replaced = true;
+		}
+		expanded.append(arg, pos);
+		args.push_back(std::move(expanded));
+	}
+	if (!replaced) args.push_back(item);
+	return args;
+}
+
+void emitString(const std::string& data, int toFd)
+{
+	size_t written = 0;
+	while (written < data.size())
+	{
+		ssize_t n = write(toFd, data.data() + written, data.size() - written);
+		if (n == -1 && errno == EINTR) continue;
+		if (n <= 0) break;
+		written += n;
+	}
+}
+
+// 读出 memfd 从 offset 开始的内容
+std::string readFdFrom(int fd, off_t offset, off_t size)
+{
+	std::string data(size > offset ? size - offset : 0, '\0');
+	ssize_t n = pread(fd, data.data(), data.size(), offset);
+	data.resize(n > 0 ? n : 0);
+	return data;
+}
+
+// 完整输出 memfd 的内容（sendfile 在内核中复制，不经过用户态缓冲区；
+// 目标不支持时（如以 O_APPEND 打开的文件）退回普通读写）
+void emitFd(int fromFd, int toFd)
+{
+	struct stat st;
+	if (fstat(fromFd, &st) != 0) return;
+	off_t offset = 0;
+	while (offset < st.st_size)
+	{
+		ssize_t n = sendfile(toFd, fromFd, &offset, st.st_size - offset);
+		if (n == -1 && errno == EINTR) continue;
+		if (n == -1 && (errno == EINVAL || errno == ENOSYS))
+		{
+			emitString(readFdFrom(fromFd, offset, st.st_size), toFd);
+			return;
+		}
+		if (n <= 0) break;
+	}
+}
+
+// 读出 memfd 的全部内容并关闭
+std::string drainFd(int fd)
+{
+	std::string data;
+	struct stat st;
+	if (fd != -1 && fstat(fd, &st) == 0) data = readFdFrom(fd, 0, st.st_size);
+	if (fd != -1) close(fd);
+	return data;
+}
+
+void emitResult(ParallelResult& result)
+{
+	if (result.outFd != -1)
+	{
+		emitFd(result.outFd, STDOUT_FILENO);
+		emitFd(result.errFd, STDERR_FILENO);
+		close(result.outFd);
+		close(result.errFd);
+		result.outFd = result.errFd = -1;
+	}
+	else
+	{
+		emitString(result.out, STDOUT_FILENO);
+		emitString(result.err, STDERR_FILENO);
+		result.out.clear();
+		result.err.clear();
+	}
+}
+
+// 任务结束：按完成顺序直接输出；-k 时输出所有已就绪的前缀，
+// 暂时不能输出的读入内存并关闭 memfd，避免大量任务时 fd 耗尽
+void finishJob(ParallelRun& run, size_t index)
+{
+	std::lock_guard<std::mutex> lock(run.emitMutex);
+	ParallelResult& result = run.results[index];
+	result.done = true;
+
+	if (!run.keepOrder)
+	{
+		emitResult(result);
+		return;
+	}
+
+	if (index != run.nextToEmit)
+	{
+		result.out = drainFd(result.outFd);
+		result.err = drainFd(result.errFd);
+		result.outFd = result.errFd = -1;
+		return;
+	}
+	while (run.nextToEmit < run.results.size() && run.results[run.nextToEmit].done)
+	{
+		emitResult(run.results[run.nextToEmit]);
+		run.nextToEmit++;
+	}
+}
+
+// 执行一个任务：输出重定向到 memfd，经由与普通外部命令相同的 launchExternal 启动
+void runJob(ParallelRun& run, size_t index)
+{
+	ParallelResult& result = run.results[index];
+	std::vector<std::string> args = expandTemplate(run.templateArgs, run.items[index]);
+
+	CommandInfo cmdInfo;
+	for (const auto& arg : args)
+	{
+		cmdInfo.args.push_back({ arg, false });
+	}
+
+	auto path = run.paths.find(args[0]);
+	result.outFd = memfd_create("parallel-out", MFD_CLOEXEC);
+	result.errFd = memfd_create("parallel-err", MFD_CLOEXEC);
+	if (path == run.paths.end() || path->second.empty() || result.outFd == -1 || result.errFd == -1)
+	{
+		std::string message = args[0] + ": " + (result.outFd == -1 || result.errFd == -1 ? std::strerror(errno) : "command not found") + "\n";
+		if (result.errFd != -1) write(result.errFd, message.data(), message.size());
+		result.failed = true;
+		finishJob(run, index);
+		return;
+	}
+
+	pid_t pid = launchExternal(path->second, cmdInfo, { { result.outFd, STDOUT_FILENO }, { result.errFd, STDERR_FILENO } }, -1);
+	if (pid > 0)
+	{
+		// 只等待自己启动的进程，不能用 wait(-1) 抢走其它线程的子进程
+		int status = 0;
+		while (waitpid(pid, &status, 0) == -1 && errno == EINTR) {}
+		result.failed = !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+		// 交互模式下 shell 忽略 SIGINT，Ctrl-C 只终止正在运行的任务，由此得知用户要中止整个 parallel
+		if (WIFSIGNALED(status) && WTERMSIG(status) == SIGINT) run.cancelled = true;
+	}
+	else
+	{
+		result.failed = true;
+	}
+	finishJob(run, index);
+}
+
+// 取下一个任务：先取自己队列的前端，空了再从其它队列后端窃取；已取消时返回 false
+bool nextJob(ParallelRun& run, size_t worker, size_t& index)
+{
+	if (run.cancelled) return false;
+	size_t count = run.queues.size();
+	for (size_t k = 0; k < count; ++k)
+	{
+		WorkQueue& queue = run.queues[(worker + k) % count];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.items.empty()) continue;
+		if (k == 0)
+		{
+			index = queue.items.front();
+			queue.items.pop_front();
+		}
+		else
+		{
+			index = queue.items.back();
+			queue.items.pop_back();
+		}
+		return true;
+	}
+	return false;
+}
+
+//=============================================================================
+// parallel 命令
+//=============================================================================
+
+// parallel 是否从 stdin 读取输入项（没有 ::: 时）
+bool parallelReadsStdin(const CommandInfo& cmdInfo)
+{
+	for (const auto& arg : cmdInfo.args)
+	{
+		if (arg.value == ":::" && !arg.quoted) return false;
+	}
+	return true;
+}
+
+// 从 stdin 读取输入项，每行一项（忽略空行）
+void readItemsFromStdin(std::vector<std::string>& items)
+{
+	std::string pending;
+	char buf[65536];
+	while (true)
+	{
+		ssize_t n = read(STDIN_FILENO, buf, sizeof(buf));
+		if (n == -1 && errno == EINTR) continue;
+		if (n <= 0) break;
+		pending.append(buf, n);
+		size_t start = 0;
+		size_t newline;
+		while ((newline = pending.find('\n', start)) != std::string::npos)
+		{
+			if (newline > start) items.emplace_back(pending, start, newline - start);
+			start = newline + 1;
+		}
+		pending.erase(0, start);
+	}
+	if (!pending.empty()) items.push_back(std::move(pending));
+}
+
+// 执行 parallel 命令
+int executeParallel(const CommandInfo& cmdInfo)
+{
+	ParallelRun run;
+	size_t jobs = std::max(1u, std::thread::hardware_concurrency());
+
+	size_t argIndex = 1;
+	while (argIndex < cmdInfo.args.size())
+	{
+		std::string_view arg = cmdInfo.args[argIndex].value;
+		if (arg == "-k")
+		{
+			run.keepOrder = true;
+			argIndex++;
+		}
+		else if (arg == "-j" && argIndex + 1 < cmdInfo.args.size())
+		{
+			try
+			{
+				jobs = std::max(1, std::stoi(std::string(cmdInfo.args[argIndex + 1].value)));
+			}
+			catch (...)
+			{
+				std::cerr << "parallel: " << cmdInfo.args[argIndex + 1].value << ": invalid job count" << std::endl;
+				return 2;
+			}
+			argIndex += 2;
+		}
+		else if (arg == "--")
+		{
+			argIndex++;
+			break;
+		}
+		else
+		{
+			break;
+		}
+	}
+
+	bool itemsFromArgs = false;
+	for (; argIndex < cmdInfo.args.size(); ++argIndex)
+	{
+		const ArgToken& arg = cmdInfo.args[argIndex];
+		if (arg.value == ":::" && !arg.quoted)
+		{
+			itemsFromArgs = true;
+			continue;
+		}
+		if (itemsFromArgs)
+			run.items.emplace_back(arg.value);
+		else
+			run.templateArgs.emplace_back(arg.value);
+	}
+
+	if (run.templateArgs.empty())
+	{
+		std::cerr << "parallel: usage: parallel [-j N] [-k] command [args...] [::: items...]" << std::endl;
+		return 2;
+	}
+	if (!itemsFromArgs) readItemsFromStdin(run.items);
+	if (run.items.empty()) return 0;
+
+	// 命令名通常对所有任务相同，在主线程中查找一次
+	for (const auto& item : run.items)
+	{
+		std::string name = expandTemplate({ run.templateArgs[0] }, item)[0];
+		if (run.paths.count(name) == 0) run.paths[name] = findExecutable(name);
+		if (run.templateArgs[0].find("{}") == std::string::npos) break;
+	}
+
+	// 按连续区间分给各工作线程，相邻的输入项由同一线程按顺序执行（-j 100000 也不会每项一个线程）
+	jobs = std::min({ jobs, MAX_PARALLEL_JOBS, run.items.size() });
+	run.results = std::vector<ParallelResult>(run.items.size());
+	run.queues = std::vector<WorkQueue>(jobs);
+	for (size_t w = 0; w < jobs; ++w)
+	{
+		size_t begin = run.items.size() * w / jobs;
+		size_t end = run.items.size() * (w + 1) / jobs;
+		for (size_t i = begin; i < end; ++i)
+		{
+			run.queues[w].items.push_back(i);
+		}
+	}
+
+	// 环境缓存在启动线程之前建好，各线程只读
+	exportedEnvironment();
+
+	std::vector<std::thread> workers;
+	for (size_t w = 0; w < jobs; ++w)
+	{
+		workers.emplace_back([&run, w]() {
+			size_t index;
+			while (nextJob(run, w, index))
+			{
+				runJob(run, index);
+			}
+		});
+	}
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+
+	if (run.cancelled)
+	{
+		std::cout << std::endl; // 与前台命令被 Ctrl-C 终止时一样只换行
+		return 128 + SIGINT;
+	}
+	size_t failed = std::count_if(run.results.begin(), run.results.end(), [](const ParallelResult& r) { return r.failed; });
+	return static_cast<int>(std::min<size_t>(failed, 101));
+}
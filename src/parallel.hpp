@@ -0,0 +1,23 @@
+#pragma once
+
+#include "parser.hpp"
+
+//=============================================================================
+// parallel 内置命令
+//=============================================================================
+
+// parallel [-j N] [-k] command [args...] [::: items...]
+// 对每个输入项（::: 之后的参数，或 stdin 的每一行）执行一次命令模板：
+// 参数中的 {} 替换为输入项，没有 {} 时把输入项追加为最后一个参数。
+// N 个工作线程（默认 CPU 核数，最多 MAX_PARALLEL_JOBS）从各自的队列取任务，空闲时从其它队列窃取；
+// 每个任务的输出先写入内存文件，结束后整体输出，不同任务的输出不会交错。
+// -k 按输入顺序输出，否则按完成顺序输出
+// 退出状态为失败的任务数（超过 100 时为 101），与 GNU parallel 相同。
+// 任务被 SIGINT 终止（Ctrl-C）时不再启动新任务，等正在运行的任务结束后返回 130
+int executeParallel(const CommandInfo& cmdInfo);
+
+// -j 的上限：每个任务占一个线程、一个子进程和两个 memfd
+constexpr size_t MAX_PARALLEL_JOBS = 256;
+
+// parallel 是否从 stdin 读取输入项（没有 ::: 时）
+bool parallelReadsStdin(const CommandInfo& cmdInfo);
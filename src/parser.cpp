@@ -0,0 +1,781 @@
+#include "parser.hpp"
+
+#include <cctype>
+
+// 去除字符串尾部空白
+std::string trimRight(const std::string& str)
+{
+	size_t end = str.find_last_not_of(" \t");
+	return (end == std::string::npos) ? "" : str.substr(0, end + 1);
+}
+
+std::string decodeEchoEscapes(std::string_view input)
+{
+	std::string result;
+	bool escapeNext = false;
+
+	for (size_t i = 0; i < input.length(); ++i)
+	{
+		char c = input[i];
+
+		if (escapeNext)
+		{
+			switch (c)
+			{
+			case 'n': result += 'n'; break;
+			case 't': result += 't'; break;
+			case 'r': result += 'r'; break;
+			case '\\': result += '\\'; break;
+			case '"': result += '"'; break;
+			default:
+				if (c >= '0' && c <= '7')
+				{
+					int octalValue = c - '0';
+					size_t j = i + 1;
+					int digitCount = 1;
+
+					while (j < input.length() && digitCount < 3)
+					{
+						char nextChar = input[j];
+						if (nextChar >= '0' && nextChar <= '7')
+						{
+							octalValue = octalValue * 8 + (nextChar - '0');
+							j++;
+							digitCount++;
+						}
+						else break;
+					}
+
+					result += static_cast<char>(octalValue);
+					i = j - 1;
+				}
+				else
+				{
+					result += '\\';
+					result += c;
+				}
+				break;
+			}
+			escapeNext = false;
+		}
+		else if (c == '\\')
+		{
+			escapeNext = true;
+		}
+		else
+		{
+			result += c;
+		}
+	}
+
+	if (escapeNext)
+	{
+		result += '\\';
+	}
+
+	return result;
+}
+
+// 找到 $( 对应的 )：跳过引号和转义，计算嵌套的括号，没有闭合时返回 npos
+size_t findSubstitutionEnd(std::string_view line, size_t start)
+{
+	int depth = 1;
+	bool inSingleQuotes = false;
+	bool inDoubleQuotes = false;
+	for (size_t i = start; i < line.length(); ++i)
+	{
+		char c = line[i];
+		if (inSingleQuotes)
+		{
+			if (c == '\'') inSingleQuotes = false;
+			continue;
+		}
+		if (c == '\\')
+		{
+			i++;
+			continue;
+		}
+		if (inDoubleQuotes)
+		{
+			if (c == '"') inDoubleQuotes = false;
+			continue;
+		}
+		if (c == '\'') inSingleQuotes = true;
+		else if (c == '"') inDoubleQuotes = true;
+		else if (c == '(') depth++;
+		else if (c == ')' && --depth == 0) return i;
+	}
+	return std::string_view::npos;
+}
+
+// 找到反引号命令的结尾，command 为去掉 \` \\ \$ 转义后的命令，没有闭合时返回 npos
+size_t findBacktickEnd(std::string_view line, size_t start, std::string& command)
+{
+	for (size_t i = start; i < line.length(); ++i)
+	{
+		char c = line[i];
+		if (c == '`') return i;
+		if (c == '\\' && i + 1 < line.length())
+		{
+			char next = line[++i];
+			if (next != '`' && next != '\\' && next != '$') command += c;
+			command += next;
+			continue;
+		}
+		command += c;
+	}
+	return std::string_view::npos;
+}
+
+// 命令名之前的 NAME=value 是赋值：= 之前是合法的变量名，且不含引号、转义和替换
+bool isAssignmentWord(std::string_view word, size_t quoteStart, size_t substitutionStart)
+{
+	size_t eq = word.find('=');
+	if (eq == std::string_view::npos || eq == 0 || eq >= quoteStart || eq >= substitutionStart) return false;
+	if (std::isdigit(static_cast<unsigned char>(word[0]))) return false;
+	for (size_t i = 0; i < eq; ++i)
+	{
+		if (!std::isalnum(static_cast<unsigned char>(word[i])) && word[i] != '_') return false;
+	}
+	return true;
+}
+
+// $ 之后的变量名：$NAME、${NAME}、$? $$ $# 和 $0-$9；end 为变量引用最后一个字符的下标
+// 不是变量引用时返回 false（$ 作为普通字符）
+bool parseVariableReference(std::string_view line, size_t dollar, std::string& name, size_t& end)
+{
+	if (dollar + 1 >= line.length()) return false;
+	char next = line[dollar + 1];
+	if (next == '{')
+	{
+		end = line.find('}', dollar + 2);
+		if (end == std::string_view::npos) return false;
+		name = line.substr(dollar + 2, end - dollar - 2);
+		return true;
+	}
+	if (next == '?' || next == '$' || next == '#' || next == '!' || std::isdigit(static_cast<unsigned char>(next)))
+	{
+		name = next;
+		end = dollar + 1;
+		return true;
+	}
+	if (!std::isalpha(static_cast<unsigned char>(next)) && next != '_') return false;
+	end = dollar + 1;
+	while (end + 1 < line.length() && (std::isalnum(static_cast<unsigned char>(line[end + 1])) || line[end + 1] == '_'))
+	{
+		end++;
+	}
+	name = line.substr(dollar + 1, end - dollar);
+	return true;
+}
+
+// 单遍词法分析：一次扫描同时完成列表/管道切分、复合命令、引号/转义处理和重定向识别
+void parseLine(std::string_view line, ParsedLine& parsed)
+{
+	parsed.lists.resize(1);
+	parsed.lists[0].pipelines.clear();
+	parsed.syntaxError = false;
+	parsed.errorToken = {};
+	parsed.patterns.clear();
+	parsed.hereDocuments.clear();
+	parsed.arena.reset(line.length() * 2 + 1);
+	CommandArena& arena = parsed.arena;
+
+	// 当前单词的去向：普通参数、重定向的目标、<< 的定界符
+	enum class WordTarget { Arg, Redirect, HereDelimiter };
+
+	// 预留参数空间，常见命令只需一次分配
+	constexpr size_t TYPICAL_ARG_COUNT = 8;
+	CommandInfo current;
+	current.args.reserve(TYPICAL_ARG_COUNT);
+	Pipeline pipeline;                             // 正在构建的管道
+	Connector connector = Connector::Sequence;     // 正在构建的管道与前一条的连接方式
+	size_t listIndex = 0;                          // 正在构建的列表
+	WordTarget target = WordTarget::Arg;
+	size_t redirectIndex = 0;     // 等待目标单词的重定向（current.redirects 的下标）
+	bool stripTabs = false;       // 正在读取的定界符属于 <<-
+	bool inWord = false;          // 当前单词已开始（空引号 '' 也算一个单词）
+	bool inSingleQuotes = false;
+	bool inDoubleQuotes = false;
+	bool escapeNext = false;
+	bool argSingleQuoted = false;
+	bool argQuoted = false;
+	bool argSubstituted = false;  // 当前单词含替换
+	size_t argQuoteStart = 0;     // 当前单词中第一个引号/转义的位置（判断赋值用）
+	size_t argSubstitutionStart = 0;
+	bool argGlob = false;         // 当前单词含未加引号的 * ? [
+	std::vector<size_t> argLiteralMeta; // 当前单词中加引号的 * ? [ 和反斜杠的位置，作为模式时需要转义
+
+	// 尚未闭合的 { 或 (：外层正在构建的管道暂存在这里，闭合后继续
+	struct OpenGroup
+	{
+		size_t listIndex;
+		Pipeline pipeline;
+		Connector connector;
+		char closer;
+	};
+	std::vector<OpenGroup> groups;
+
+	auto fail = [&](std::string_view token) {
+		if (parsed.syntaxError) return;
+		parsed.syntaxError = true;
+		parsed.errorToken = token;
+	};
+
+	// 命令位置：当前命令还没有任何参数（关键字和复合命令只在这里识别）
+	auto atCommandStart = [&]() {
+		return current.args.empty() && current.body < 0 && current.assignments.empty() && target == WordTarget::Arg;
+	};
+
+	// 记录当前单词中 arena 当前位置的一处替换，以及它所在的参数或重定向
+	auto addSubstitution = [&](Substitution&& substitution) {
+		substitution.kind = target == WordTarget::Redirect ? WordKind::Redirect : WordKind::Arg;
+		substitution.argIndex = target == WordTarget::Redirect ? redirectIndex : current.args.size();
+		substitution.offset = arena.size - arena.wordStart;
+		substitution.quoted = inDoubleQuotes;
+		current.substitutions.push_back(std::move(substitution));
+		if (!argSubstituted) argSubstitutionStart = arena.size - arena.wordStart;
+		inWord = true;
+		argSubstituted = true;
+	};
+
+	auto markQuoted = [&]() {
+		if (!argQuoted) argQuoteStart = arena.size - arena.wordStart;
+		argQuoted = true;
+	};
+
+	// 写入引号中或被转义的字符：通配符按字面处理
+	auto pushQuoted = [&](char c) {
+		if (c == '*' || c == '?' || c == '[' || c == '\\') argLiteralMeta.push_back(arena.size - arena.wordStart);
+		arena.push(c);
+	};
+
+	// 路径名展开的模式：没有加引号的通配符时就是单词本身，否则在它们前面加反斜杠转义
+	auto globPattern = [&](std::string_view word) -> std::string_view {
+		if (!argGlob) return {};
+		if (argLiteralMeta.empty()) return word;
+		std::string& pattern = parsed.patterns.emplace_back();
+		size_t next = 0;
+		for (size_t i = 0; i < word.size(); ++i)
+		{
+			if (next < argLiteralMeta.size() && argLiteralMeta[next] == i)
+			{
+				pattern += '\\';
+				next++;
+			}
+			pattern += word[i];
+		}
+		return pattern;
+	};
+
+	auto endWord = [&]() {
+		if (!inWord) return;
+		std::string_view word = arena.finishWord();
+
+		// 管道开头未加引号的 time 是关键字，不作为命令参数
+		bool isTimeKeyword = target == WordTarget::Arg && !argQuoted && !argSubstituted && !pipeline.timed
+			&& pipeline.commands.empty() && atCommandStart() && word == "time";
+
+		switch (target)
+		{
+		case WordTarget::Arg:
+			if (isTimeKeyword)
+				pipeline.timed = true;
+			else if (current.body >= 0)
+				fail(word); // 复合命令之后只能跟重定向
+			else if (current.args.empty() && isAssignmentWord(word, argQuoted ? argQuoteStart : word.size(),
+				argSubstituted ? argSubstitutionStart : word.size()))
+			{
+				// 赋值中的替换改为指向这条赋值
+				for (auto& substitution : current.substitutions)
+				{
+					if (substitution.kind == WordKind::Arg && substitution.argIndex == 0)
+					{
+						substitution.kind = WordKind::Assignment;
+						substitution.argIndex = current.assignments.size();
+					}
+				}
+				current.assignments.push_back(word);
+			}
+			else
+				current.args.push_back({ word, argSingleQuoted, argQuoted, globPattern(word) });
+			break;
+		case WordTarget::Redirect: current.redirects[redirectIndex].target = word; break;
+		case WordTarget::HereDelimiter:
+			// 定界符中有引号或转义：正文按字面使用
+			current.redirects[redirectIndex].hereDocument = static_cast<int>(parsed.hereDocuments.size());
+			parsed.hereDocuments.push_back({ std::string(word), stripTabs, !argQuoted });
+			break;
+		}
+		target = WordTarget::Arg;
+		inWord = false;
+		argSingleQuoted = false;
+		argQuoted = false;
+		argSubstituted = false;
+		argQuoteStart = 0;
+		argSubstitutionStart = 0;
+		argGlob = false;
+		argLiteralMeta.clear();
+	};
+
+	// 结束当前命令，加入管道；没有命令时返回 false
+	auto endCommand = [&]() {
+		endWord();
+		if (current.args.empty() && current.body < 0 && current.assignments.empty()) return false;
+		pipeline.commands.push_back(std::move(current));
+		current = CommandInfo{};
+		current.args.reserve(TYPICAL_ARG_COUNT);
+		return true;
+	};
+
+	// 结束当前管道，加入当前列表；管道为空时返回 false（| 之后缺少命令则是语法错误）
+	auto endPipeline = [&](std::string_view token) {
+		if (!endCommand())
+		{
+			if (!pipeline.commands.empty()) fail(token);
+			return false;
+		}
+		pipeline.connector = connector;
+		parsed.lists[listIndex].pipelines.push_back(std::move(pipeline));
+		pipeline = Pipeline{};
+		connector = Connector::Sequence;
+		return true;
+	};
+
+	// && || ; &：结束一条管道，之后必须还有命令（; & 可以出现在列表末尾）
+	auto endListItem = [&](std::string_view token, Connector next) {
+		if (!endPipeline(token))
+		{
+			fail(token);
+			return;
+		}
+		connector = next;
+	};
+
+	auto openGroup = [&](std::string_view token, char closer) {
+		endWord();
+		if (!atCommandStart())
+		{
+			fail(token);
+			return;
+		}
+		groups.push_back({ listIndex, std::move(pipeline), connector, closer });
+		listIndex = parsed.lists.size();
+		parsed.lists.emplace_back();
+		pipeline = Pipeline{};
+		connector = Connector::Sequence;
+	};
+
+	auto closeGroup = [&](std::string_view token, char closer) {
+		if (groups.empty() || groups.back().closer != closer)
+		{
+			fail(token);
+			return;
+		}
+		endPipeline(token);
+		if (connector != Connector::Sequence || parsed.lists[listIndex].pipelines.empty())
+		{
+			fail(token);
+			return;
+		}
+
+		OpenGroup& group = groups.back();
+		int body = static_cast<int>(listIndex);
+		listIndex = group.listIndex;
+		pipeline = std::move(group.pipeline);
+		connector = group.connector;
+		groups.pop_back();
+
+		current = CommandInfo{};
+		current.body = body;
+		current.subshell = closer == ')';
+	};
+
+	// 保留字 { } 必须是独立的单词：后面是空白、行尾或控制符
+	auto isWordEnd = [&](size_t pos) {
+		if (pos >= line.length()) return true;
+		char next = line[pos];
+		return next == ' ' || next == '\t' || next == ';' || next == '&' || next == '|' || next == ')';
+	};
+
+	for (size_t i = 0; i < line.length() && !parsed.syntaxError; ++i)
+	{
+		char c = line[i];
+
+		if (escapeNext)
+		{
+			// shell 认为转义字符可以转义任何字符
+			if (!inSingleQuotes)
+			{
+				if (inDoubleQuotes)
+				{
+					// 双引号中仅 \" \\ \$ \` 有效
+					if (c != '"' && c != '\\' && c != '$' && c != '`')
+					{
+						pushQuoted('\\');
+					}
+				}
+				else
+				{
+					// 无引号时空格 tab ' " \ $ ` 和通配符 * ? [ 可被转义
+					if (c != ' ' && c != '\t' && c != '\'' && c != '"' && c != '\\' && c != '$' && c != '`'
+						&& c != '*' && c != '?' && c != '[')
+					{
+						pushQuoted('\\');
+					}
+				}
+			}
+			else
+			{
+				// 单引号中转义无效
+				pushQuoted('\\');
+			}
+
+			if (!argQuoted) argQuoteStart = arena.size - arena.wordStart;
+			argQuoted = true;
+			pushQuoted(c);
+			inWord = true;
+			escapeNext = false;
+			continue;
+		}
+
+		if (c == '\\' && !inSingleQuotes)
+		{
+			escapeNext = true;
+			continue;
+		}
+
+		if (c == '\'' && !inDoubleQuotes)
+		{
+			inSingleQuotes = !inSingleQuotes;
+			if (inSingleQuotes) argSingleQuoted = true;
+			inWord = true;
+			markQuoted();
+			continue;
+		}
+
+		if (c == '"' && !inSingleQuotes)
+		{
+			inDoubleQuotes = !inDoubleQuotes;
+			inWord = true;
+			markQuoted();
+			continue;
+		}
+
+		// 命令替换 $(...) 和 `...`：记录命令及其在单词中的位置，执行前展开（单引号和 here-document 定界符中无效）
+		if (!inSingleQuotes && target != WordTarget::HereDelimiter && (c == '`' || (c == '$' && i + 1 < line.length() && line[i + 1] == '(')))
+		{
+			Substitution substitution;
+			size_t end = c == '`' ? findBacktickEnd(line, i + 1, substitution.text) : findSubstitutionEnd(line, i + 2);
+			if (end == std::string_view::npos)
+			{
+				fail({});
+				break;
+			}
+			if (c == '$') substitution.text = line.substr(i + 2, end - i - 2);
+			addSubstitution(std::move(substitution));
+			i = end;
+			continue;
+		}
+
+		// 变量 $NAME / ${NAME}：同样记录位置，执行前取值
+		if (!inSingleQuotes && target != WordTarget::HereDelimiter && c == '$')
+		{
+			Substitution substitution;
+			size_t end;
+			if (i + 1 < line.length() && line[i + 1] == '{' && line.find('}', i + 2) == std::string_view::npos)
+			{
+				fail({}); // 未闭合的 ${
+				break;
+			}
+			if (parseVariableReference(line, i, substitution.text, end))
+			{
+				substitution.variable = true;
+				addSubstitution(std::move(substitution));
+				i = end;
+				continue;
+			}
+		}
+
+		if (inSingleQuotes || inDoubleQuotes)
+		{
+			pushQuoted(c);
+			continue;
+		}
+
+		// 以下为引号之外的字符
+		if (c == ' ' || c == '\t')
+		{
+			endWord();
+			continue;
+		}
+
+		// 重定向之后必须是单词，不能直接跟操作符
+		if (target != WordTarget::Arg && !inWord
+			&& (c == '|' || c == ';' || c == '&' || c == '(' || c == ')' || c == '<' || c == '>'))
+		{
+			fail(line.substr(i, 1));
+			break;
+		}
+
+		bool doubled = i + 1 < line.length() && line[i + 1] == c;
+
+		if (c == '|')
+		{
+			if (doubled)
+			{
+				endListItem(line.substr(i, 2), Connector::Or);
+				i++;
+			}
+			else if (!endCommand())
+			{
+				fail(line.substr(i, 1));
+			}
+			continue;
+		}
+
+		if (c == ';')
+		{
+			endListItem(line.substr(i, 1), Connector::Sequence);
+			continue;
+		}
+
+		// &&：and 连接；单独的 &：之前的 and-or 列表作为后台作业（&> 是重定向）
+		if (c == '&' && !(i + 1 < line.length() && line[i + 1] == '>'))
+		{
+			if (doubled)
+			{
+				endListItem(line.substr(i, 2), Connector::And);
+				i++;
+			}
+			else
+			{
+				endListItem(line.substr(i, 1), Connector::Sequence);
+				if (!parsed.syntaxError) parsed.lists[listIndex].pipelines.back().background = true;
+			}
+			continue;
+		}
+
+		if (c == '(')
+		{
+			openGroup(line.substr(i, 1), ')');
+			continue;
+		}
+
+		if (c == ')')
+		{
+			closeGroup(line.substr(i, 1), ')');
+			continue;
+		}
+
+		if ((c == '{' || c == '}') && !inWord && atCommandStart() && isWordEnd(i + 1))
+		{
+			if (c == '{')
+				openGroup(line.substr(i, 1), '}');
+			else
+				closeGroup(line.substr(i, 1), '}');
+			continue;
+		}
+
+		// 单词开头的 # 开始注释
+		if (c == '#' && !inWord)
+		{
+			break;
+		}
+
+		// 重定向：[N]< [N]> [N]>> [N]>| [N]<> [N]>&M [N]<&M [N]<< [N]<<- [N]<<< 以及 &> &>>
+		// fd 数字 N 只在单词开头、紧跟 < 或 > 时才算
+		size_t op = i;
+		int redirectFd = -1;
+		if (std::isdigit(static_cast<unsigned char>(c)) && !inWord && target == WordTarget::Arg)
+		{
+			constexpr size_t MAX_FD_DIGITS = 9;
+			size_t j = i;
+			while (j < line.length() && j - i <= MAX_FD_DIGITS && std::isdigit(static_cast<unsigned char>(line[j]))) j++;
+			if (j - i <= MAX_FD_DIGITS && j < line.length() && (line[j] == '<' || line[j] == '>'))
+			{
+				redirectFd = std::stoi(std::string(line.substr(i, j - i)));
+				op = j;
+			}
+		}
+		bool bothOutputs = c == '&'; // 走到这里的 & 一定是 &>
+		if (c == '<' || c == '>' || bothOutputs || redirectFd >= 0)
+		{
+			endWord();
+			if (bothOutputs) op++;
+			auto at = [&](size_t offset) { return op + offset < line.length() ? line[op + offset] : '\0'; };
+
+			Redirect redirect{ RedirectKind::Output, line[op] == '<' ? 0 : 1 };
+			if (line[op] == '<')
+			{
+				if (at(1) == '<' && at(2) == '<')
+				{
+					redirect.kind = RedirectKind::HereString;
+					op += 2;
+				}
+				else if (at(1) == '<')
+				{
+					redirect.kind = RedirectKind::HereDocument;
+					op++;
+					stripTabs = at(1) == '-';
+					if (stripTabs) op++;
+				}
+				else if (at(1) == '>' || at(1) == '&')
+				{
+					redirect.kind = at(1) == '>' ? RedirectKind::ReadWrite : RedirectKind::Duplicate;
+					op++;
+				}
+				else
+				{
+					redirect.kind = RedirectKind::Input;
+				}
+			}
+			else if (at(1) == '>')
+			{
+				redirect.kind = RedirectKind::Append;
+				op++;
+			}
+			else if (at(1) == '&' && !bothOutputs)
+			{
+				redirect.kind = RedirectKind::Duplicate;
+				op++;
+			}
+			else if (at(1) == '|')
+			{
+				op++; // >|：与 > 相同（没有 noclobber）
+			}
+			if (redirectFd >= 0) redirect.fd = redirectFd;
+
+			redirectIndex = current.redirects.size();
+			current.redirects.push_back(redirect);
+			if (bothOutputs)
+			{
+				// &> file：> file 之后 2>&1
+				current.redirects.push_back({ RedirectKind::Duplicate, 2, "1" });
+			}
+			target = redirect.kind == RedirectKind::HereDocument ? WordTarget::HereDelimiter : WordTarget::Redirect;
+			i = op;
+			continue;
+		}
+
+		if (c == '*' || c == '?' || c == '[') argGlob = true;
+		arena.push(c);
+		inWord = true;
+	}
+
+	if (parsed.syntaxError) return;
+
+	if (escapeNext)
+	{
+		pushQuoted('\\');
+		inWord = true;
+	}
+
+	// 行尾：重定向之后缺少单词，&& || 之后缺少命令，或 { ( 没有闭合
+	if (!inWord && target != WordTarget::Arg)
+	{
+		fail({});
+		return;
+	}
+	endPipeline({});
+	if (connector != Connector::Sequence || !groups.empty()) fail({});
+}
+
+// 读入第 index 个 here-document 的正文：定界符未加引号时处理转义并记录其中的替换，然后让所属命令指向正文
+void setHereDocumentBody(ParsedLine& parsed, size_t index, std::string_view body)
+{
+	HereDocument& document = parsed.hereDocuments[index];
+	std::vector<Substitution> substitutions;
+	if (!document.expand)
+	{
+		document.body.assign(body);
+	}
+	else
+	{
+		// 与双引号中相同：\$ \` \\ 去掉反斜杠，\换行 是续行，其它反斜杠保留
+		std::string& text = document.body;
+		text.clear();
+		text.reserve(body.length());
+		for (size_t i = 0; i < body.length(); ++i)
+		{
+			char c = body[i];
+			if (c == '\\' && i + 1 < body.length())
+			{
+				char next = body[i + 1];
+				if (next == '\n')
+				{
+					i++;
+					continue;
+				}
+				if (next == '$' || next == '`' || next == '\\')
+				{
+					text += next;
+					i++;
+					continue;
+				}
+			}
+
+			Substitution substitution;
+			size_t end = std::string_view::npos;
+			if (c == '`')
+			{
+				end = findBacktickEnd(body, i + 1, substitution.text);
+			}
+			else if (c == '$' && i + 1 < body.length() && body[i + 1] == '(')
+			{
+				end = findSubstitutionEnd(body, i + 2);
+				if (end != std::string_view::npos) substitution.text = body.substr(i + 2, end - i - 2);
+			}
+			else if (c == '$' && parseVariableReference(body, i, substitution.text, end))
+			{
+				substitution.variable = true;
+			}
+
+			if (end == std::string_view::npos)
+			{
+				// 普通字符，或没有闭合的替换：按字面保留
+				text += c;
+				continue;
+			}
+			substitution.kind = WordKind::Redirect;
+			substitution.offset = text.length();
+			substitution.quoted = true;
+			substitutions.push_back(std::move(substitution));
+			i = end;
+		}
+	}
+
+	// 所属的重定向：正文作为它的目标，替换记在它的下标上
+	for (auto& list : parsed.lists)
+	{
+		for (auto& pipeline : list.pipelines)
+		{
+			for (auto& cmdInfo : pipeline.commands)
+			{
+				for (size_t r = 0; r < cmdInfo.redirects.size(); ++r)
+				{
+					if (cmdInfo.redirects[r].hereDocument != static_cast<int>(index)) continue;
+					cmdInfo.redirects[r].target = document.body;
+					for (Substitution substitution : substitutions)
+					{
+						substitution.argIndex = r;
+						cmdInfo.substitutions.push_back(std::move(substitution));
+					}
+				}
+			}
+		}
+	}
+}
+
+// 从解析好的参数构建 argv：直接指向 arena 中以 '\0' 结尾的字符串，不复制
+std::vector<char*> buildArgv(const CommandInfo& cmdInfo)
+{
+	std::vector<char*> argv;
+	argv.reserve(cmdInfo.args.size() + 1);
+	for (const auto& arg : cmdInfo.args)
+	{
+		argv.push_back(const_cast<char*>(arg.value.data()));
+	}
+	argv.push_back(nullptr);
+	return argv;
+}
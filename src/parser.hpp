@@ -0,0 +1,163 @@
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//=============================================================================
+// 命令解析
+//=============================================================================
+
+// 命令行解析用的内存区：所有单词反转义后依次写入同一块缓冲区并以 '\0' 结尾，
+// 参数只是指向这里的视图，构建 argv 时不再为每个参数分配内存。
+// 输出长度不会超过 输入长度 + 单词数，所以按 2 * 行长 + 1 一次分配，之后不再扩容，视图始终有效
+struct CommandArena
+{
+	std::unique_ptr<char[]> data;
+	size_t size{};
+	size_t capacity{};
+	size_t wordStart{};
+
+	void reset(size_t cap)
+	{
+		if (cap > capacity)
+		{
+			data = std::make_unique<char[]>(cap);
+			capacity = cap;
+		}
+		size = wordStart = 0;
+	}
+
+	void push(char c) { data[size++] = c; }
+
+	// 结束当前单词，返回指向它的视图（data() 可作为 C 字符串使用）
+	std::string_view finishWord()
+	{
+		std::string_view word(data.get() + wordStart, size - wordStart);
+		data[size++] = '\0';
+		wordStart = size;
+		return word;
+	}
+};
+
+struct ArgToken
+{
+	std::string_view value;
+	bool singleQuoted;
+	bool quoted{}; // 含有任何引号或转义（关键字识别等只认未加引号的单词）
+	std::string_view pattern{}; // 含未加引号的 * ? [ 时为路径名展开的模式（加引号的通配符已转义），否则为空
+};
+
+// 替换所在单词的去向
+enum class WordKind
+{
+	Arg,
+	Assignment,
+	Redirect // 重定向的目标（文件名、fd、here-string 的单词，或定界符未加引号的 here-document 正文）
+};
+
+// 单词中的一处替换：命令替换 $(...) / `...` 或变量 $VAR / ${VAR}
+// 执行前求值（捕获命令输出或取变量值），插入单词的 offset 处
+struct Substitution
+{
+	std::string text;    // 命令替换：要执行的命令（反引号中的转义已处理）；变量：变量名
+	bool variable{};     // 变量替换
+	WordKind kind{};
+	size_t argIndex{};   // 所在的参数 / 赋值 / 重定向的下标
+	size_t offset{};     // 在单词（反转义后）中的插入位置
+	bool quoted{};       // 在双引号中：结果不按空白分割
+};
+
+// 重定向的种类
+enum class RedirectKind
+{
+	Input,        // N< file（N 默认为 0）
+	Output,       // N> file、N>| file（N 默认为 1）
+	Append,       // N>> file
+	ReadWrite,    // N<> file（N 默认为 0）
+	Duplicate,    // N>&M、N<&M：N 成为 M 的副本，M 为 - 时关闭 N
+	HereDocument, // N<< DELIM、N<<- DELIM：读入正文后 target 指向正文
+	HereString    // N<<< word：内容之后加换行
+};
+
+// 一个重定向。各重定向按出现顺序依次应用，后面的可以引用前面的结果（> out 2>&1 与 2>&1 > out 不同）
+// &> file 和 &>> file 解析为两个：> file（或 >> file）和 2>&1
+struct Redirect
+{
+	RedirectKind kind;
+	int fd;                  // 被重定向的 fd
+	std::string_view target; // 文件名（以 '\0' 结尾）、M、here-string 的单词或 here-document 的正文
+	int hereDocument{ -1 };  // HereDocument：ParsedLine::hereDocuments 的下标
+};
+
+struct CommandInfo
+{
+	std::vector<ArgToken> args{};
+	std::vector<Redirect> redirects; // 按出现顺序，通常为空
+	int body{ -1 };      // 复合命令 { list; } / ( list )：ParsedLine::lists 的下标，此时 args 为空
+	bool subshell{};     // ( list )：在子 shell 中执行
+	std::vector<Substitution> substitutions; // 按出现顺序，通常为空
+	std::vector<std::string_view> assignments; // 命令名之前的 NAME=value（以 '\0' 结尾，可直接作为环境变量字符串）
+};
+
+// here-document：<<DELIM / <<-DELIM 所在行之后直到 DELIM 行为止的各行
+struct HereDocument
+{
+	std::string delimiter; // 结束行（引号已去掉）
+	bool stripTabs{};      // <<-：正文各行和结束行去掉开头的 tab
+	bool expand{};         // 定界符没有引号：正文中的 $VAR ${VAR} $(...) `...` 执行前展开
+	std::string body;      // 正文（转义已处理），由 setHereDocumentBody 填入
+};
+
+// 管道与前一条管道的连接方式
+enum class Connector
+{
+	Sequence, // ; & 或列表开头：无条件执行
+	And,      // &&：前一条成功时执行
+	Or        // ||：前一条失败时执行
+};
+
+// 一条管道：| 连接的各条命令，只有一条时即为简单命令或复合命令
+struct Pipeline
+{
+	std::vector<CommandInfo> commands;
+	Connector connector{};
+	bool timed{};      // 以 time 关键字开头
+	bool background{}; // 以 & 结束：以它结尾的 and-or 列表作为后台作业执行
+};
+
+// 命令列表：按顺序排列的管道，以 && || 连接的相邻管道组成 and-or 列表
+struct CommandList
+{
+	std::vector<Pipeline> pipelines;
+};
+
+// 一行命令的解析结果：lists[0] 为整行，复合命令的内容依次存放在后面
+// 所有字符串都是 arena 中的视图，ParsedLine 必须比使用它的 CommandInfo 活得久
+struct ParsedLine
+{
+	CommandArena arena;
+	std::deque<std::string> patterns; // 含加引号通配符的单词转义后的模式（很少用到）
+	std::deque<HereDocument> hereDocuments; // 按出现顺序，正文在解析之后读入
+	std::vector<CommandList> lists;
+	bool syntaxError{};
+	std::string_view errorToken; // 出错处的记号，为空表示意外的行尾
+};
+
+// 去除字符串尾部空白
+std::string trimRight(const std::string& str);
+
+// 解码 echo 参数中的转义序列
+std::string decodeEchoEscapes(std::string_view input);
+
+// 单遍词法分析：一次扫描同时完成列表/管道切分、复合命令、引号/转义处理和重定向识别
+void parseLine(std::string_view line, ParsedLine& parsed);
+
+// 读入第 index 个 here-document 的正文（<<- 的 tab 已去掉）：定界符未加引号时处理 \$ \` \\ 和续行，
+// 其中的 $VAR ${VAR} $(...) `...` 记录为所属命令的替换；然后让所属的重定向指向正文
+void setHereDocumentBody(ParsedLine& parsed, size_t index, std::string_view body);
+
+// 从解析好的参数构建 argv：直接指向 arena 中以 '\0' 结尾的字符串，不复制
+std::vector<char*> buildArgv(const CommandInfo& cmdInfo);
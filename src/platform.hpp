@@ -0,0 +1,13 @@
+#pragma once
+
+#ifdef _WIN32
+#include <io.h>
+#define access _access
+#define X_OK 4
+#define PATH_SEP '\\'
+#define PATH_DELIM ';'
+#else
+#include <unistd.h>
+#define PATH_SEP '/'
+#define PATH_DELIM ':'
+#endif
@@ -0,0 +1,87 @@
+#include "script_runner.hpp"
+#include "executor.hpp"
+
+#include <cerrno>
+#include <cstring>     // memchr()
+#include <sstream>
+#include <unistd.h>
+#include <vector>
+
+// 带缓冲的按行读取：一次 read() 读入 64KB，而不是每个字符一次系统调用
+struct BufferedLineReader
+{
+	int fd;
+	std::vector<char> buffer = std::vector<char>(64 * 1024);
+	size_t pos{};
+	size_t len{};
+	bool seekable{ true };
+
+	explicit BufferedLineReader(int inputFd) : fd(inputFd) {}
+
+	// 读取一行（不含换行符），输入结束且没有数据时返回 false
+	bool readLine(std::string& line)
+	{
+		line.clear();
+		while (true)
+		{
+			const char* start = buffer.data() + pos;
+			const char* newline = static_cast<const char*>(std::memchr(start, '\n', len - pos));
+			if (newline != nullptr)
+			{
+				line.append(start, newline - start);
+				pos += newline - start + 1;
+				return true;
+			}
+			line.append(start, len - pos);
+			pos = len = 0;
+
+			ssize_t n = read(fd, buffer.data(), buffer.size());
+			if (n < 0 && errno == EINTR) continue;
+			if (n <= 0) return !line.empty();
+			len = static_cast<size_t>(n);
+		}
+	}
+
+	// 把已读入缓冲区但尚未执行的数据退还给 fd，
+	// 这样与 shell 共享 stdin 的子进程能从正确位置继续读取（仅对可 seek 的输入有效）
+	void syncOffset()
+	{
+		if (!seekable || pos == len) return;
+		if (lseek(fd, -static_cast<off_t>(len - pos), SEEK_CUR) == -1)
+		{
+			seekable = false;
+			return;
+		}
+		pos = len = 0;
+	}
+};
+
+// 逐行执行来自 fd 的命令
+void runCommandsFromFd(int fd)
+{
+	BufferedLineReader reader(fd);
+	// here-document 的正文从同一输入中读取
+	auto readMore = [&reader, fd](std::string& next) {
+		if (!reader.readLine(next)) return false;
+		if (fd == STDIN_FILENO) reader.syncOffset();
+		return true;
+	};
+	std::string line;
+	while (reader.readLine(line))
+	{
+		if (fd == STDIN_FILENO) reader.syncOffset();
+		if (!executeCommandLine(line, readMore)) break;
+	}
+}
+
+// 逐行执行 -c 参数中的命令
+void runCommandString(const std::string& commands)
+{
+	std::istringstream input(commands);
+	auto readMore = [&input](std::string& next) { return static_cast<bool>(std::getline(input, next)); };
+	std::string line;
+	while (std::getline(input, line))
+	{
+		if (!executeCommandLine(line, readMore)) break;
+	}
+}
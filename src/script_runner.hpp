@@ -0,0 +1,13 @@
+#pragma once
+
+#include <string>
+
+//=============================================================================
+// 非交互模式（脚本文件 / -c / 管道输入）
+//=============================================================================
+
+// 逐行执行来自 fd 的命令
+void runCommandsFromFd(int fd);
+
+// 逐行执行 -c 参数中的命令
+void runCommandString(const std::string& commands);
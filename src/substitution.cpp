@@ -0,0 +1,386 @@
+#include "substitution.hpp"
+#include "builtins.hpp"
+#include "command_lookup.hpp"
+#include "executor.hpp"
+#include "glob.hpp"
+#include "jobs.hpp"
+#include "options.hpp"
+#include "variables.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>       // strerror()
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>    // memfd_create()
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+//=============================================================================
+// 输出捕获
+//=============================================================================
+
+// 从管道读取全部数据：直接读入 string 的空闲空间，每次读取的长度随已读数据量翻倍
+void readAll(int fd, std::string& output)
+{
+	constexpr size_t MIN_CHUNK = 64 * 1024;
+	while (true)
+	{
+		size_t used = output.size();
+		size_t chunk = std::max(MIN_CHUNK, used);
+		ssize_t n = 0;
+		output.resize_and_overwrite(used + chunk, [&](char* buf, size_t) {
+			n = read(fd, buf + used, chunk);
+			return used + (n > 0 ? n : 0);
+		});
+		if (n == -1 && errno == EINTR) continue;
+		if (n <= 0) break;
+	}
+}
+
+// 内置命令的输出写入同一个内存文件，用完截断后复用（替换的展开在执行内置命令之前完成，不会嵌套使用）
+int captureFd()
+{
+	static int fd = memfd_create("substitution", MFD_CLOEXEC);
+	return fd;
+}
+
+// 能否在 shell 进程中执行：单条不修改 shell 状态、不读 stdin 的内置命令
+bool capturableInProcess(const ParsedLine& parsed)
+{
+	const std::vector<Pipeline>& pipelines = parsed.lists[0].pipelines;
+	if (pipelines.size() != 1 || pipelines[0].background || pipelines[0].timed) return false;
+	if (pipelines[0].commands.size() != 1) return false;
+	const CommandInfo& cmdInfo = pipelines[0].commands[0];
+	if (cmdInfo.body >= 0 || cmdInfo.args.empty()) return false;
+	return isBuiltinCommand(std::string(cmdInfo.args[0].value)) && !builtinModifiesShell(cmdInfo) && !builtinReadsStdin(cmdInfo);
+}
+
+// 在 shell 进程中执行内置命令，stdout 临时指向内存文件
+std::string captureBuiltin(const CommandInfo& cmdInfo)
+{
+	std::string output;
+	int fd = captureFd();
+	if (fd == -1)
+	{
+		std::cerr << "memfd_create: " << std::strerror(errno) << std::endl;
+		return output;
+	}
+
+	SavedShellFds saved;
+	if (!redirectShellFds(cmdInfo, { { fd, STDOUT_FILENO } }, saved))
+	{
+		shellExitStatus = 1;
+		return output;
+	}
+	shellExitStatus = executeBuiltinInPipeline(cmdInfo);
+	restoreShellFds(saved);
+
+	struct stat st;
+	if (fstat(fd, &st) == 0 && st.st_size > 0)
+	{
+		output.resize_and_overwrite(st.st_size, [fd](char* buf, size_t size) {
+			ssize_t n = pread(fd, buf, size, 0);
+			return static_cast<size_t>(n > 0 ? n : 0);
+		});
+	}
+	ftruncate(fd, 0);
+	lseek(fd, 0, SEEK_SET);
+	return output;
+}
+
+// 在子 shell 中执行命令列表，通过管道读取输出
+std::string captureSubshell(const ParsedLine& parsed)
+{
+	std::string output;
+	int pipeFds[2];
+	if (pipe2(pipeFds, O_CLOEXEC) == -1)
+	{
+		std::cerr << "pipe: " << std::strerror(errno) << std::endl;
+		shellExitStatus = 1;
+		return output;
+	}
+
+	pid_t pid = fork();
+	if (pid == 0)
+	{
+		setupChildJobControl(-1);
+		jobControlEnabled = false;
+		jobTable.clear();
+		dup2(pipeFds[1], STDOUT_FILENO);
+		close(pipeFds[0]);
+		close(pipeFds[1]);
+		executeList(parsed, parsed.lists[0]);
+		std::cout.flush();
+		_exit(shellExitStatus);
+	}
+	close(pipeFds[1]);
+	if (pid == -1)
+	{
+		std::cerr << "fork: " << std::strerror(errno) << std::endl;
+		close(pipeFds[0]);
+		shellExitStatus = 1;
+		return output;
+	}
+
+	readAll(pipeFds[0], output);
+	close(pipeFds[0]);
+
+	// 只等待自己的子 shell，其它子进程留给作业表
+	int status = 0;
+	while (waitpid(pid, &status, 0) == -1 && errno == EINTR) {}
+	shellExitStatus = exitCodeFromStatus(status);
+	return output;
+}
+
+// 执行 command 并捕获其标准输出，退出状态记录在 shellExitStatus
+std::string captureOutput(std::string_view command)
+{
+	ParsedLine parsed;
+	parseLine(command, parsed);
+	if (parsed.syntaxError)
+	{
+		if (parsed.errorToken.empty())
+			std::cerr << "syntax error: unexpected end of file" << std::endl;
+		else
+			std::cerr << "syntax error near unexpected token `" << parsed.errorToken << "'" << std::endl;
+		shellExitStatus = 2;
+		return {};
+	}
+	if (parsed.lists[0].pipelines.empty())
+	{
+		shellExitStatus = 0;
+		return {};
+	}
+
+	std::string output;
+	if (capturableInProcess(parsed))
+	{
+		// 内置命令的参数中也可能有命令替换，先展开
+		ExpandedCommands expanded;
+		expandCommands(parsed.lists[0].pipelines[0].commands, expanded);
+		if (!expanded.commands.empty()) output = captureBuiltin(expanded.commands[0]);
+	}
+	else
+	{
+		output = captureSubshell(parsed);
+	}
+
+	// 去掉末尾的换行
+	while (!output.empty() && output.back() == '\n')
+	{
+		output.pop_back();
+	}
+	return output;
+}
+
+//=============================================================================
+// 展开
+//=============================================================================
+
+bool hasSubstitutions(const std::vector<CommandInfo>& commands)
+{
+	return std::any_of(commands.begin(), commands.end(), [](const CommandInfo& c) { return !c.substitutions.empty(); });
+}
+
+bool hasGlobArgs(const CommandInfo& cmdInfo)
+{
+	return std::any_of(cmdInfo.args.begin(), cmdInfo.args.end(), [](const ArgToken& arg) { return !arg.pattern.empty(); });
+}
+
+bool needsExpansion(const std::vector<CommandInfo>& commands)
+{
+	return std::any_of(commands.begin(), commands.end(), [](const CommandInfo& c) { return !c.substitutions.empty() || hasGlobArgs(c); });
+}
+
+// 变量的值：$? 上一条命令的退出状态，$$ shell 的进程号，$! 最近的后台作业的进程号，
+// $# 位置参数个数（没有位置参数）；未设置的变量为空
+std::string variableValue(const std::string& name)
+{
+	if (name == "?") return std::to_string(shellExitStatus);
+	if (name == "$") return std::to_string(getpid());
+	if (name == "!") return lastBackgroundPid > 0 ? std::to_string(lastBackgroundPid) : std::string();
+	if (name == "#") return "0";
+	const std::string* value = getVariable(name);
+	return value != nullptr ? *value : std::string();
+}
+
+// 展开一个单词：word 中 offset 处依次插入各替换的输出
+// split 时未加引号的输出按空白分割，结果可能是多个单词，也可能没有单词
+// patterns 非空时同时生成每个单词路径名展开用的模式：word 的部分取自 pattern（为空则转义 word），
+// 未加引号的输出中的通配符保持有效，加引号的转义
+void expandWord(std::string_view word, std::string_view pattern, const std::vector<const Substitution*>& substitutions,
+	bool split, bool quoted, std::vector<std::string>& words, std::vector<std::string>* patterns)
+{
+	std::vector<std::string> result(1);
+	std::vector<std::string> resultPatterns(1);
+	bool hasContent = quoted; // 当前单词即使为空也要保留（如 "$(true)"）
+	size_t pos = 0;
+	size_t patternPos = 0;
+
+	// 单词的一段 [pos, end) 追加到模式：pattern 中每个 \ 转义的字符对应 word 中的一个字符
+	auto appendWordPattern = [&](size_t end) {
+		if (patterns == nullptr) return;
+		if (pattern.empty())
+		{
+			appendGlobLiteral(resultPatterns.back(), word.substr(pos, end - pos));
+			return;
+		}
+		size_t start = patternPos;
+		for (size_t i = pos; i < end; ++i)
+		{
+			patternPos += pattern[patternPos] == '\\' ? 2 : 1;
+		}
+		resultPatterns.back().append(pattern.substr(start, patternPos - start));
+	};
+
+	for (const Substitution* substitution : substitutions)
+	{
+		result.back().append(word.substr(pos, substitution->offset - pos));
+		appendWordPattern(substitution->offset);
+		if (substitution->offset > pos) hasContent = true;
+		pos = substitution->offset;
+
+		std::string output = substitution->variable ? variableValue(substitution->text) : captureOutput(substitution->text);
+		if (!split || substitution->quoted)
+		{
+			result.back() += output;
+			if (patterns != nullptr) appendGlobLiteral(resultPatterns.back(), output);
+			continue;
+		}
+
+		// 按空白分割：空白处结束当前单词，开始新的单词
+		size_t i = 0;
+		while (i < output.size())
+		{
+			if (output[i] == ' ' || output[i] == '\t' || output[i] == '\n')
+			{
+				while (i < output.size() && (output[i] == ' ' || output[i] == '\t' || output[i] == '\n')) i++;
+				if (!result.back().empty() || hasContent)
+				{
+					result.emplace_back();
+					resultPatterns.emplace_back();
+					hasContent = false;
+				}
+				continue;
+			}
+			size_t start = i;
+			while (i < output.size() && output[i] != ' ' && output[i] != '\t' && output[i] != '\n') i++;
+			result.back().append(output, start, i - start);
+			resultPatterns.back().append(output, start, i - start);
+		}
+	}
+	result.back().append(word.substr(pos));
+	appendWordPattern(word.size());
+	if (pos < word.size()) hasContent = true;
+
+	if (result.back().empty() && !hasContent)
+	{
+		result.pop_back();
+		resultPatterns.pop_back();
+	}
+	for (size_t i = 0; i < result.size(); ++i)
+	{
+		words.push_back(std::move(result[i]));
+		if (patterns != nullptr) patterns->push_back(hasGlobChars(resultPatterns[i]) ? std::move(resultPatterns[i]) : std::string());
+	}
+}
+
+// 依次执行各命令替换、取变量的值，把结果代入参数，再做路径名展开
+void expandCommands(const std::vector<CommandInfo>& commands, ExpandedCommands& expanded)
+{
+	expanded.commands.clear();
+	expanded.storage.clear();
+
+	std::vector<std::string> matches;
+	for (const CommandInfo& original : commands)
+	{
+		if (original.substitutions.empty() && !hasGlobArgs(original))
+		{
+			expanded.commands.push_back(original);
+			continue;
+		}
+
+		CommandInfo cmdInfo = original;
+		cmdInfo.substitutions.clear();
+		cmdInfo.args.clear();
+		cmdInfo.assignments.clear();
+
+		std::vector<const Substitution*> pending;
+		auto collect = [&](WordKind kind, size_t argIndex) {
+			pending.clear();
+			for (const auto& substitution : original.substitutions)
+			{
+				if (substitution.kind == kind && substitution.argIndex == argIndex)
+				{
+					pending.push_back(&substitution);
+				}
+			}
+		};
+
+		// 赋值：值不分割，展开结果仍是一条 NAME=value
+		std::vector<std::string> words;
+		for (size_t i = 0; i < original.assignments.size(); ++i)
+		{
+			collect(WordKind::Assignment, i);
+			if (pending.empty())
+			{
+				cmdInfo.assignments.push_back(original.assignments[i]);
+				continue;
+			}
+			words.clear();
+			expandWord(original.assignments[i], {}, pending, false, true, words, nullptr);
+			expanded.storage.push_back(std::move(words[0]));
+			cmdInfo.assignments.push_back(expanded.storage.back());
+		}
+
+		// 路径名展开：有匹配时代之以排序后的路径，没有匹配时保持原样（nullglob 时去掉）
+		auto addArg = [&](const ArgToken& arg, std::string_view pattern) {
+			matches.clear();
+			if (pattern.empty() || !expandGlob(pattern, matches))
+			{
+				if (pattern.empty() || !optNullglob) cmdInfo.args.push_back({ arg.value, arg.singleQuoted, arg.quoted });
+				return;
+			}
+			for (auto& match : matches)
+			{
+				expanded.storage.push_back(std::move(match));
+				cmdInfo.args.push_back({ expanded.storage.back(), false, true });
+			}
+		};
+
+		std::vector<std::string> patterns;
+		for (size_t i = 0; i < original.args.size(); ++i)
+		{
+			const ArgToken& arg = original.args[i];
+			collect(WordKind::Arg, i);
+			if (pending.empty())
+			{
+				addArg(arg, arg.pattern);
+				continue;
+			}
+			words.clear();
+			patterns.clear();
+			expandWord(arg.value, arg.pattern, pending, true, arg.quoted, words, &patterns);
+			for (size_t w = 0; w < words.size(); ++w)
+			{
+				expanded.storage.push_back(std::move(words[w]));
+				addArg({ expanded.storage.back(), arg.singleQuoted, arg.quoted }, patterns[w]);
+			}
+		}
+
+		// 重定向目标：展开结果作为一个文件名，不分割（here-string 的单词和 here-document 的正文也一样）
+		for (size_t i = 0; i < cmdInfo.redirects.size(); ++i)
+		{
+			collect(WordKind::Redirect, i);
+			if (pending.empty()) continue;
+			words.clear();
+			expandWord(cmdInfo.redirects[i].target, {}, pending, false, true, words, nullptr);
+			expanded.storage.push_back(words.empty() ? std::string() : std::move(words[0]));
+			cmdInfo.redirects[i].target = expanded.storage.back();
+		}
+
+		if (!cmdInfo.args.empty() || cmdInfo.body >= 0 || !cmdInfo.assignments.empty()) expanded.commands.push_back(std::move(cmdInfo));
+	}
+}
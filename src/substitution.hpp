@@ -0,0 +1,35 @@
+#pragma once
+
+#include "parser.hpp"
+
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//=============================================================================
+// 展开：命令替换 $(...) / `...`、变量 $VAR / ${VAR} 和路径名 * ? [...]
+//=============================================================================
+
+// 展开后的管道：命令的参数和重定向目标指向 storage 中的字符串
+struct ExpandedCommands
+{
+	std::vector<CommandInfo> commands;
+	std::deque<std::string> storage; // deque 追加元素时不移动已有字符串，视图保持有效
+};
+
+// 管道中是否有需要展开的替换
+bool hasSubstitutions(const std::vector<CommandInfo>& commands);
+
+// 管道中是否有需要展开的替换或通配符
+bool needsExpansion(const std::vector<CommandInfo>& commands);
+
+// 依次执行各命令替换、取变量的值，代入参数：命令输出去掉末尾的换行，未加引号时按空白分割成多个参数
+// 赋值和重定向目标不分割；展开后没有参数也没有赋值的命令（如单独的 $(true)）被去掉
+// 之后参数中未加引号的 * ? [ 按路径名展开（目录列表在命令行执行期间缓存）
+void expandCommands(const std::vector<CommandInfo>& commands, ExpandedCommands& expanded);
+
+// 执行 command 并捕获其标准输出，退出状态记录在 shellExitStatus
+// 不修改 shell 状态的单条内置命令（pwd、echo、type 等）直接在 shell 进程中执行，输出写入内存文件；
+// 其它命令在 fork 出的子 shell 中执行，通过管道读取
+std::string captureOutput(std::string_view command);
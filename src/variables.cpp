@@ -0,0 +1,221 @@
+#include "variables.hpp"
+#include "command_lookup.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <iostream>
+
+extern char** environ;
+
+std::unordered_map<std::string, ShellVariable, VariableNameHash, std::equal_to<>> shellVariables;
+
+// 导出环境缓存："NAME=value" 字符串和指向它们的以 nullptr 结尾的数组
+struct EnvironmentCache
+{
+	std::vector<std::string> entries;
+	std::vector<char*> envp;
+	bool dirty{ true };
+};
+
+EnvironmentCache environmentCache;
+
+// 变量改变后的通知：导出变量使环境缓存失效，PATH 使命令哈希表失效
+void variableChanged(std::string_view name, bool exported)
+{
+	if (exported) environmentCache.dirty = true;
+	if (name == "PATH") onPathChanged();
+}
+
+// 启动时导入进程环境，全部作为导出变量
+void initShellVariables()
+{
+	for (char** env = environ; *env != nullptr; ++env)
+	{
+		const char* eq = std::strchr(*env, '=');
+		if (eq == nullptr) continue;
+		std::string name(*env, eq - *env);
+		shellVariables[name] = { eq + 1, true };
+	}
+	environmentCache.dirty = true;
+}
+
+// 变量的值，未设置时返回 nullptr
+const std::string* getVariable(std::string_view name)
+{
+	auto it = shellVariables.find(name);
+	if (it == shellVariables.end() || !it->second.hasValue) return nullptr;
+	return &it->second.value;
+}
+
+// 赋值（保留原有的导出属性）
+void setVariable(std::string_view name, std::string_view value)
+{
+	auto it = shellVariables.find(name);
+	if (it == shellVariables.end())
+	{
+		it = shellVariables.emplace(std::string(name), ShellVariable{}).first;
+	}
+	it->second.value = value;
+	it->second.hasValue = true;
+	variableChanged(name, it->second.exported);
+}
+
+// export NAME[=value] / export -n NAME
+void exportVariable(std::string_view name, bool exported)
+{
+	auto it = shellVariables.find(name);
+	if (it == shellVariables.end())
+	{
+		if (!exported) return;
+		it = shellVariables.emplace(std::string(name), ShellVariable{ {}, true, false }).first;
+	}
+	if (it->second.exported == exported) return;
+	it->second.exported = exported;
+	variableChanged(name, true);
+}
+
+// unset NAME
+void unsetVariable(std::string_view name)
+{
+	auto it = shellVariables.find(name);
+	if (it == shellVariables.end()) return;
+	bool exported = it->second.exported;
+	shellVariables.erase(it);
+	variableChanged(name, exported);
+}
+
+// 是否为合法的变量名：字母或下划线开头，其后为字母、数字、下划线
+bool isValidVariableName(std::string_view name)
+{
+	if (name.empty() || std::isdigit(static_cast<unsigned char>(name[0]))) return false;
+	return std::all_of(name.begin(), name.end(), [](char c) { return std::isalnum(static_cast<unsigned char>(c)) || c == '_'; });
+}
+
+// 传给 execve / posix_spawn 的环境：导出变量改变时才重建
+char* const* exportedEnvironment()
+{
+	if (environmentCache.dirty)
+	{
+		environmentCache.entries.clear();
+		for (const auto& [name, variable] : shellVariables)
+		{
+			if (variable.exported && variable.hasValue) environmentCache.entries.push_back(name + "=" + variable.value);
+		}
+		// entries 不再改变之后才取指针
+		environmentCache.envp.clear();
+		for (auto& entry : environmentCache.entries)
+		{
+			environmentCache.envp.push_back(entry.data());
+		}
+		environmentCache.envp.push_back(nullptr);
+		environmentCache.dirty = false;
+	}
+	return environmentCache.envp.data();
+}
+
+// 命令前缀赋值 VAR=x cmd：在导出环境的基础上覆盖同名变量，只作用于这一条命令
+// 同一个变量赋值多次时只有最后一次生效（A=1 A=2 cmd 的环境中只有 A=2）
+std::vector<char*> environmentWith(const std::vector<std::string_view>& assignments)
+{
+	// "NAME=" 前缀相同即为同一个变量
+	auto sameName = [](std::string_view entry, std::string_view assignment) {
+		size_t nameEnd = assignment.find('=') + 1;
+		return entry.substr(0, nameEnd) == assignment.substr(0, nameEnd);
+	};
+
+	std::vector<char*> envp;
+	for (char* const* env = exportedEnvironment(); *env != nullptr; ++env)
+	{
+		// 被覆盖的变量不复制
+		std::string_view entry(*env);
+		bool overridden = std::any_of(assignments.begin(), assignments.end(),
+			[&](std::string_view assignment) { return sameName(entry, assignment); });
+		if (!overridden) envp.push_back(*env);
+	}
+	for (size_t i = 0; i < assignments.size(); ++i)
+	{
+		bool reassigned = std::any_of(assignments.begin() + i + 1, assignments.end(),
+			[&](std::string_view later) { return sameName(assignments[i], later); });
+		if (!reassigned) envp.push_back(const_cast<char*>(assignments[i].data()));
+	}
+	envp.push_back(nullptr);
+	return envp;
+}
+
+//=============================================================================
+// export / unset
+//=============================================================================
+
+// 执行 export 命令：export [-n] [-p] [NAME[=value]...]
+int executeExport(const CommandInfo& cmdInfo)
+{
+	const std::vector<ArgToken>& args = cmdInfo.args;
+	bool unexport = false;
+	size_t argIndex = 1;
+	while (argIndex < args.size() && args[argIndex].value.starts_with('-'))
+	{
+		if (args[argIndex].value == "-n")
+			unexport = true;
+		else if (args[argIndex].value != "-p")
+		{
+			std::cerr << "export: " << args[argIndex].value << ": invalid option" << std::endl;
+			return 2;
+		}
+		argIndex++;
+	}
+
+	// 没有变量名：以可重新输入的格式列出导出变量
+	if (argIndex >= args.size())
+	{
+		std::vector<std::pair<std::string_view, const ShellVariable*>> exported;
+		for (const auto& [name, variable] : shellVariables)
+		{
+			if (variable.exported) exported.push_back({ name, &variable });
+		}
+		std::sort(exported.begin(), exported.end());
+		for (const auto& [name, variable] : exported)
+		{
+			std::cout << "declare -x " << name;
+			if (variable->hasValue) std::cout << "=\"" << variable->value << "\"";
+			std::cout << std::endl;
+		}
+		return 0;
+	}
+
+	int status = 0;
+	for (; argIndex < args.size(); ++argIndex)
+	{
+		std::string_view arg = args[argIndex].value;
+		size_t eq = arg.find('=');
+		std::string_view name = arg.substr(0, eq);
+		if (!isValidVariableName(name))
+		{
+			std::cerr << "export: `" << arg << "': not a valid identifier" << std::endl;
+			status = 1;
+			continue;
+		}
+		if (eq != std::string_view::npos) setVariable(name, arg.substr(eq + 1));
+		exportVariable(name, !unexport);
+	}
+	return status;
+}
+
+// 执行 unset 命令：unset [-v] NAME...
+int executeUnset(const CommandInfo& cmdInfo)
+{
+	const std::vector<ArgToken>& args = cmdInfo.args;
+	int status = 0;
+	for (size_t i = 1; i < args.size(); ++i)
+	{
+		if (i == 1 && args[i].value == "-v") continue;
+		if (!isValidVariableName(args[i].value))
+		{
+			std::cerr << "unset: `" << args[i].value << "': not a valid identifier" << std::endl;
+			status = 1;
+			continue;
+		}
+		unsetVariable(args[i].value);
+	}
+	return status;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "parser.hpp"
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+//=============================================================================
+// shell 变量与导出环境
+//=============================================================================
+
+struct ShellVariable
+{
+	std::string value;
+	bool exported{};
+	bool hasValue{ true }; // export NAME 可以先标记一个尚未赋值的变量
+};
+
+// 支持以 string_view 查找，展开 $VAR 时不必构造临时 string
+struct VariableNameHash
+{
+	using is_transparent = void;
+	size_t operator()(std::string_view name) const { return std::hash<std::string_view>{}(name); }
+};
+
+extern std::unordered_map<std::string, ShellVariable, VariableNameHash, std::equal_to<>> shellVariables;
+
+// 启动时导入进程环境，全部作为导出变量
+void initShellVariables();
+
+// 变量的值，未设置时返回 nullptr
+const std::string* getVariable(std::string_view name);
+
+// 赋值（保留原有的导出属性）
+void setVariable(std::string_view name, std::string_view value);
+
+// export NAME[=value] / export -n NAME
+void exportVariable(std::string_view name, bool exported);
+
+// unset NAME
+void unsetVariable(std::string_view name);
+
+// 是否为合法的变量名：字母或下划线开头，其后为字母、数字、下划线
+bool isValidVariableName(std::string_view name);
+
+// 传给 execve / posix_spawn 的环境：导出变量改变时才重建，平时每次启动进程直接复用
+char* const* exportedEnvironment();
+
+// 命令前缀赋值 VAR=x cmd：在导出环境的基础上覆盖同名变量，只作用于这一条命令
+// assignments 中的字符串即 "NAME=value"，必须以 '\0' 结尾并在进程启动前保持有效
+std::vector<char*> environmentWith(const std::vector<std::string_view>& assignments);
+
+// 执行 export / unset 命令
+int executeExport(const CommandInfo& cmdInfo);
+int executeUnset(const CommandInfo& cmdInfo);
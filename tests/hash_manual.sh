@@ -0,0 +1,20 @@
+# hash -p 指定的条目不做可执行检查：照常执行，无法执行时退出状态为 126
+# 由 ctest 运行，任何一步不符合预期时以非 0 状态退出
+
+hash -p /etc/passwd notexec
+notexec 2>/dev/null
+test $? -eq 126 || exit 1
+
+# 条目仍保留在哈希表中
+hash -t notexec >/dev/null
+test $? -eq 0 || exit 2
+
+# 管道的最后一段
+true | notexec 2>/dev/null
+test $? -eq 126 || exit 3
+
+# 命令找不到仍为 127
+nonexistent_command_for_test >/dev/null 2>&1
+test $? -eq 127 || exit 4
+
+exit 0
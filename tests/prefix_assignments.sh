@@ -0,0 +1,19 @@
+# 命令前缀赋值：同一个变量赋值多次时只有最后一次生效（由 ctest 运行，任何一步不符合预期时以非 0 状态退出）
+
+# 子进程的环境中只有最后一次赋值
+A=1 A=2 env | grep -c '^A=' | grep -qx 1 || exit 1
+A=1 A=2 sh -c 'test "$A" = 2' || exit 2
+
+# 覆盖已导出的变量时同样只保留最后一次
+export B=0
+B=1 B=2 env | grep '^B=' | grep -qx B=2 || exit 3
+
+# PATH=... 按最后一次赋值查找命令
+PATH=/nonexistent PATH=/usr/bin:/bin true || exit 4
+PATH=/usr/bin:/bin PATH=/nonexistent true >/dev/null 2>&1
+test $? -eq 127 || exit 5
+
+# SHELL_PIPE_SIZE=... 同样是最后一次生效（F_GETPIPE_SZ 读取管道缓冲区大小）
+SHELL_PIPE_SIZE=64k SHELL_PIPE_SIZE=256k true | python3 -c 'import fcntl; print(fcntl.fcntl(0, 1032))' | grep -qx 262144 || exit 6
+
+exit 0
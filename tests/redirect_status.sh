@@ -0,0 +1,18 @@
+# 重定向失败时外部命令不启动，退出状态为 1（不是命令找不到的 127）
+# 由 ctest 运行，任何一步不符合预期时以非 0 状态退出
+
+cat < /nonexistent/file 2>/dev/null
+test $? -eq 1 || exit 1
+
+cat <&7 2>/dev/null
+test $? -eq 1 || exit 2
+
+# 管道的最后一段
+echo x | cat < /nonexistent/file 2>/dev/null
+test $? -eq 1 || exit 3
+
+# 命令找不到仍为 127
+nonexistent_command_for_test >/dev/null 2>&1
+test $? -eq 127 || exit 4
+
+exit 0
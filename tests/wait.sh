@@ -0,0 +1,35 @@
+# wait：收集后台作业的退出状态（由 ctest 运行，任何一步不符合预期时以非 0 状态退出）
+
+# 作业号：作业已经结束，状态仍然可以收集
+sh -c 'exit 3' &
+sleep 0.1
+wait %1
+test $? -eq 3 || exit 1
+
+# 进程号（$!）：收集之后不再是本 shell 的子进程
+sh -c 'exit 5' &
+pid=$!
+wait $pid
+test $? -eq 5 || exit 2
+wait $pid 2>/dev/null
+test $? -eq 127 || exit 3
+
+# 管道作业的状态为最后一段的状态
+sh -c 'exit 7' | sh -c 'exit 4' &
+wait $!
+test $? -eq 4 || exit 4
+
+# 没有参数：等待全部作业，状态为 0
+sleep 0.2 &
+sh -c 'exit 9' &
+wait
+test $? -eq 0 || exit 5
+jobs | wc -l | grep -qx 0 || exit 6
+
+# 不存在的作业和进程
+wait %99 2>/dev/null
+test $? -eq 127 || exit 7
+wait 999999 2>/dev/null
+test $? -eq 127 || exit 8
+
+exit 0